@@ -5,33 +5,170 @@
 #include <chrono>
 #include <set>
 #include <stack>
-#include <iomanip>
 #include <limits>
 #include <string>
 #include <sstream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <map>
+#include <unordered_set>
+#include <memory>
+#include <iterator>
+#include <functional>
+#include <cerrno>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SUDOKU_HAVE_MMAP 1
+#define SUDOKU_HAVE_WRITE 1
+#endif
+
+#include "sudoku.h"
+
+using namespace sudoku;
+
+// Fixed-capacity text for one screen of output, sent with a single write
+// when flushed, so a frame costs one syscall however many pieces it has.
+// Text past CAPACITY is dropped.
+class FrameBuffer {
+public:
+    static const size_t CAPACITY = 4096;
+
+    FrameBuffer() : length(0) {}
+
+    void append(char ch) {
+        if (length < CAPACITY) data[length++] = ch;
+    }
+
+    void append(const char* text) {
+        size_t count = std::min(std::strlen(text), CAPACITY - length);
+        std::memcpy(data + length, text, count);
+        length += count;
+    }
+
+    void appendNumber(int value) {
+        char digits[16];
+        std::snprintf(digits, sizeof(digits), "%d", value);
+        append(digits);
+    }
+
+    // Write the frame after anything already sent to std::cout or stdout,
+    // then start a new one
+    void flush() {
+        std::cout.flush();
+        std::fflush(stdout);
+#ifdef SUDOKU_HAVE_WRITE
+        for (size_t done = 0; done < length;) {
+            ssize_t wrote = ::write(STDOUT_FILENO, data + done, length - done);
+            if (wrote < 0 && errno == EINTR) continue;
+            if (wrote <= 0) break;
+            done += static_cast<size_t>(wrote);
+        }
+#else
+        std::fwrite(data, 1, length, stdout);
+        std::fflush(stdout);
+#endif
+        length = 0;
+    }
+
+private:
+    char data[CAPACITY];
+    size_t length;
+};
+
+// Fixed-capacity little-endian bit stream over a caller's buffer, for the
+// game snapshot
+class BitWriter {
+public:
+    BitWriter(uint8_t* buffer, size_t bytes) : data(buffer), limit(bytes * 8), used(0) {
+        std::memset(buffer, 0, bytes);
+    }
+
+    void write(uint32_t value, int bits) {
+        for (int b = 0; b < bits; ++b, ++used) {
+            if ((value >> b) & 1) data[used / 8] |= static_cast<uint8_t>(1 << (used % 8));
+        }
+    }
+
+    size_t room() const { return limit - used; }
+
+private:
+    uint8_t* data;
+    size_t limit;
+    size_t used;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* buffer, size_t bytes) : data(buffer), limit(bytes * 8), used(0) {}
+
+    // Reads past the end come back as zero bits and make overrun() true
+    uint32_t read(int bits) {
+        uint32_t value = 0;
+        for (int b = 0; b < bits; ++b, ++used) {
+            if (used < limit && (data[used / 8] >> (used % 8)) & 1) value |= 1u << b;
+        }
+        return value;
+    }
+
+    bool overrun() const { return used > limit; }
+
+private:
+    const uint8_t* data;
+    size_t limit;
+    size_t used;
+};
 
 class SudokuGame {
 private:
-    static const int SIZE = 9;
-    static constexpr int EMPTY = 0;
-    
-    std::vector<std::vector<int>> board;
-    std::vector<std::vector<int>> solution;
-    std::vector<std::vector<bool>> fixed;
-    std::mt19937 rng;
-    
-    enum Difficulty {
-        EASY = 35,      // 35-40 clues
-        MEDIUM = 30,    // 30-35 clues
-        HARD = 25,      // 25-30 clues
-        EXPERT = 20     // 20-25 clues
+    // Whether solution holds the solution of the current givens
+    enum SolutionState {
+        SOLUTION_UNKNOWN,   // Not solved since the puzzle last changed
+        SOLUTION_KNOWN,
+        SOLUTION_NONE       // The givens have no solution
     };
 
+    Grid board;
+    Grid solution;
+    SolutionState solutionState;
+    CellSet fixed;
+    CandidateMasks boardMasks;   // Always in step with board
+    Solver solver;
+    Generator generator;
+    LogicalSolver logic;
+    const CorpusView* corpus;    // Pre-built puzzles for newGame(), if any
+    std::mt19937_64 drawRng;      // Picks corpus records
+    PuzzlePool* pool;             // Background-generated puzzles, if any
+    
     struct Move {
         int row, col, value;
         Move(int r, int c, int v) : row(r), col(c), value(v) {}
     };
 
+    // One cell change in the move journal; undoing it restores previous,
+    // and the candidate masks follow through place()/unplace()
+    struct Delta {
+        uint8_t cell;
+        uint8_t previous;
+        uint8_t value;
+        bool joined;    // Undone and redone together with the delta before it
+    };
+
+    std::vector<Delta> journal;
+    size_t applied;     // Deltas of journal on the board; the rest can be redone
+    
+    FrameBuffer frame;  // The screen being drawn
+    bool compact;
+    bool helpWanted;    // Show the command help on the next frame
+    Grid drawn;         // The board as last drawn
+
     struct CellCandidate {
         int row, col;
         std::set<int> candidates;
@@ -39,194 +176,347 @@ private:
     };
 
 public:
-    SudokuGame() : board(SIZE, std::vector<int>(SIZE, EMPTY)),
-                   solution(SIZE, std::vector<int>(SIZE, EMPTY)),
-                   fixed(SIZE, std::vector<bool>(SIZE, false)),
-                   rng(std::chrono::steady_clock::now().time_since_epoch().count()) {}
+    SudokuGame()
+        : solutionState(SOLUTION_UNKNOWN), corpus(nullptr), drawRng(std::random_device()()),
+          pool(nullptr), applied(0), compact(false), helpWanted(true) {}
+
+    explicit SudokuGame(uint64_t seed)
+        : solutionState(SOLUTION_UNKNOWN), generator(seed), corpus(nullptr), drawRng(seed),
+          pool(nullptr), applied(0), compact(false), helpWanted(true) {}
+
+    // Draw new games from corpus instead of generating them, for the
+    // difficulties it has; the corpus must outlive the game
+    void setCorpus(const CorpusView* puzzles) {
+        corpus = puzzles;
+    }
+
+    // Take new games from a background pool when it has one ready; the pool
+    // must outlive the game
+    void setPool(PuzzlePool* puzzles) {
+        pool = puzzles;
+    }
+
+    // Restart the generator RNG from a 64-bit seed
+    void setSeed(uint64_t seed) {
+        generator.setSeed(seed);
+    }
+
+    const Grid& getBoard() const { return board; }
+
+    // The solution of the current puzzle, solved on first use; an empty
+    // grid if the givens have none
+    const Grid& getSolution() {
+        if (!ensureSolution()) solution.clear();
+        return solution;
+    }
+
+    void setSolverEngine(SolverEngine solverEngine) {
+        solver.setEngine(solverEngine);
+    }
 
     // Core validation functions
     bool isValidMove(int row, int col, int num) const {
         if (row < 0 || row >= SIZE || col < 0 || col >= SIZE || 
             num < 1 || num > SIZE) return false;
         
-        // Check row
-        for (int c = 0; c < SIZE; ++c) {
-            if (c != col && board[row][c] == num) return false;
+        return board(row, col) == num || checkPlacement(boardMasks, row, col, num) == MOVE_OK;
+    }
+
+    // Check a player move without applying it, in O(1) against the board masks
+    MoveResult validateMove(int row, int col, int value) const {
+        if (row < 0 || row >= SIZE || col < 0 || col >= SIZE) return MOVE_OUT_OF_BOUNDS;
+        if (fixed[cellIndex(row, col)]) return MOVE_FIXED_CELL;
+        if (value < 0 || value > SIZE) return MOVE_INVALID_VALUE;
+        if (value == EMPTY || board(row, col) == value) return MOVE_OK;
+        return checkPlacement(boardMasks, row, col, value);
+    }
+
+    // Validate and, if valid, apply a player move (0 clears the cell). The
+    // move goes into the journal, dropping anything left to redo.
+    MoveResult applyMove(int row, int col, int value) {
+        MoveResult result = validateMove(row, col, value);
+        if (result == MOVE_OK) playCell(cellIndex(row, col), value, false);
+        return result;
+    }
+
+    // Take back the last move (or auto-solve); false if there is none
+    bool undo() {
+        if (applied == 0) return false;
+        do {
+            const Delta& delta = journal[--applied];
+            setCell(delta.cell / SIZE, delta.cell % SIZE, delta.previous);
+        } while (applied > 0 && journal[applied].joined);
+        return true;
+    }
+
+    // Replay the last move undone; false if there is none
+    bool redo() {
+        if (applied == journal.size()) return false;
+        do {
+            const Delta& delta = journal[applied++];
+            setCell(delta.cell / SIZE, delta.cell % SIZE, delta.value);
+        } while (applied < journal.size() && journal[applied].joined);
+        return true;
+    }
+
+    // Back to the givens of the same puzzle by undoing every move, one
+    // cell write per move; redo() replays them
+    void restart() {
+        while (undo()) {}
+    }
+
+    // Bytes written by saveSnapshot()
+    static const size_t SNAPSHOT_SIZE = 64;
+
+    // Write the game into SNAPSHOT_SIZE bytes at out: the givens, the
+    // solution, the board and as many of the latest journal steps as still
+    // fit, oldest first to go (redo history is not kept). The bit stream is
+    // a version byte, the step count, the 81-bit givens mask, rows 1-8 of
+    // the solution as 19-bit permutation ranks (row 9 follows from the
+    // columns), a trit per open cell (empty, solved or wrong) packed five
+    // to a byte, 3 bits per wrong value, then 12 bits per step, newest
+    // first. Returns false if the puzzle has no solution or the board has
+    // too many wrong entries to fit.
+    bool saveSnapshot(uint8_t* out) {
+        if (!ensureSolution()) return false;
+        BitWriter bits(out, SNAPSHOT_SIZE);
+        
+        int wrong = 0;
+        for (int i = 0; i < CELL_COUNT; ++i) {
+            if (board.cells[i] != EMPTY && board.cells[i] != solution.cells[i]) ++wrong;
         }
+        size_t open = CELL_COUNT - fixed.count();
+        size_t fixedBits = 16 + CELL_COUNT + 8 * PERMUTATION_BITS + (open + 4) / 5 * 8;
+        if (fixedBits + wrong * 3 > SNAPSHOT_SIZE * 8) return false;
         
-        // Check column
-        for (int r = 0; r < SIZE; ++r) {
-            if (r != row && board[r][col] == num) return false;
+        // Keep whole steps only: a joined delta needs the one before it
+        size_t steps = (SNAPSHOT_SIZE * 8 - fixedBits - wrong * 3) / DELTA_BITS;
+        steps = std::min(std::min(steps, applied), MAX_SNAPSHOT_DELTAS);
+        while (steps > 0 && steps < applied && journal[applied - steps].joined) --steps;
+        
+        bits.write(SNAPSHOT_VERSION, 8);
+        bits.write(static_cast<uint32_t>(steps), 8);
+        for (int i = 0; i < CELL_COUNT; ++i) {
+            bits.write(fixed[i], 1);
+        }
+        for (int r = 0; r < SIZE - 1; ++r) {
+            bits.write(rankRow(&solution.cells[r * SIZE]), PERMUTATION_BITS);
         }
         
-        // Check 3x3 box
-        int boxRow = (row / 3) * 3;
-        int boxCol = (col / 3) * 3;
-        for (int r = boxRow; r < boxRow + 3; ++r) {
-            for (int c = boxCol; c < boxCol + 3; ++c) {
-                if ((r != row || c != col) && board[r][c] == num) return false;
+        uint32_t group = 0, weight = 1;
+        for (int i = 0, k = 0; i < CELL_COUNT; ++i) {
+            if (fixed[i]) continue;
+            int state = board.cells[i] == EMPTY ? 0 : board.cells[i] == solution.cells[i] ? 1 : 2;
+            group += state * weight;
+            weight *= 3;
+            if (++k % 5 == 0 || static_cast<size_t>(k) == open) {
+                bits.write(group, 8);
+                group = 0;
+                weight = 1;
             }
         }
-        
-        return true;
-    }
-
-    bool isComplete() const {
-        for (int r = 0; r < SIZE; ++r) {
-            for (int c = 0; c < SIZE; ++c) {
-                if (board[r][c] == EMPTY) return false;
+        for (int i = 0; i < CELL_COUNT; ++i) {
+            int value = board.cells[i];
+            if (value != EMPTY && value != solution.cells[i]) {
+                bits.write(value - 1 - (value > solution.cells[i]), 3);
             }
         }
+        for (size_t s = 0; s < steps; ++s) {
+            const Delta& delta = journal[applied - 1 - s];
+            bits.write(delta.cell, 7);
+            bits.write(delta.previous, 4);
+            bits.write(delta.joined, 1);
+        }
         return true;
     }
 
-    // Advanced backtracking solver with multiple strategies
-    bool solveBacktrack(std::vector<std::vector<int>>& grid) {
-        int row, col;
-        if (!findBestCell(grid, row, col)) {
-            return true; // Solved
+    // Resume a game from a saveSnapshot() image. Returns false, leaving the
+    // game untouched, if the image is malformed.
+    bool loadSnapshot(const uint8_t* in) {
+        BitReader bits(in, SNAPSHOT_SIZE);
+        if (bits.read(8) != SNAPSHOT_VERSION) return false;
+        size_t steps = bits.read(8);
+        if (steps > MAX_SNAPSHOT_DELTAS) return false;
+        
+        CellSet givens;
+        for (int i = 0; i < CELL_COUNT; ++i) {
+            givens[i] = bits.read(1) != 0;
         }
-
-        std::vector<int> candidates = getCandidates(grid, row, col);
-        std::shuffle(candidates.begin(), candidates.end(), rng);
-
-        for (int num : candidates) {
-            if (isValidInGrid(grid, row, col, num)) {
-                grid[row][col] = num;
-                
-                if (solveBacktrack(grid)) {
-                    return true;
-                }
-                
-                grid[row][col] = EMPTY;
+        Grid solved;
+        for (int r = 0; r < SIZE - 1; ++r) {
+            if (!unrankRow(bits.read(PERMUTATION_BITS), &solved.cells[r * SIZE])) return false;
+        }
+        for (int c = 0; c < SIZE; ++c) {
+            int missing = 45;   // 1 + 2 + ... + 9
+            for (int r = 0; r < SIZE - 1; ++r) {
+                missing -= solved(r, c);
             }
+            if (missing < 1 || missing > SIZE) return false;
+            solved(SIZE - 1, c) = missing;
         }
+        if (!isCompleteSolution(solved)) return false;
         
-        return false;
+        Grid puzzle, played;
+        uint32_t group = 0;
+        for (int i = 0, k = 0; i < CELL_COUNT; ++i) {
+            if (givens[i]) {
+                puzzle.cells[i] = played.cells[i] = solved.cells[i];
+                continue;
+            }
+            if (k++ % 5 == 0 && (group = bits.read(8)) >= 243) return false;
+            int state = group % 3;
+            group /= 3;
+            if (state == 1) played.cells[i] = solved.cells[i];
+            if (state == 2) played.cells[i] = UNSET_CELL;
+        }
+        for (int i = 0; i < CELL_COUNT; ++i) {
+            if (played.cells[i] != UNSET_CELL) continue;
+            int value = static_cast<int>(bits.read(3)) + 1;
+            played.cells[i] = value + (value >= solved.cells[i]);
+        }
+        CandidateMasks masks;
+        if (!masks.load(played)) return false;
+        
+        // Walk the steps back from the board to recover each new value
+        std::vector<Delta> restored(steps);
+        Grid before = played;
+        for (size_t s = 0; s < steps; ++s) {
+            Delta& delta = restored[steps - 1 - s];
+            delta.cell = static_cast<uint8_t>(bits.read(7));
+            delta.previous = static_cast<uint8_t>(bits.read(4));
+            delta.joined = bits.read(1) != 0;
+            if (delta.cell >= CELL_COUNT || givens[delta.cell] || delta.previous > SIZE ||
+                before.cells[delta.cell] == delta.previous) {
+                return false;
+            }
+            delta.value = before.cells[delta.cell];
+            before.cells[delta.cell] = delta.previous;
+        }
+        if (bits.overrun()) return false;
+        
+        board = played;
+        solution = solved;
+        fixed = givens;
+        boardMasks = masks;
+        solutionState = SOLUTION_KNOWN;
+        journal.swap(restored);
+        applied = steps;
+        return true;
     }
 
-    // Find cell with minimum candidates (MRV heuristic)
-    bool findBestCell(const std::vector<std::vector<int>>& grid, int& row, int& col) {
-        int minCandidates = SIZE + 1;
-        bool found = false;
-        
+    bool isComplete() const {
         for (int r = 0; r < SIZE; ++r) {
             for (int c = 0; c < SIZE; ++c) {
-                if (grid[r][c] == EMPTY) {
-                    int candidateCount = getCandidates(grid, r, c).size();
-                    if (candidateCount < minCandidates) {
-                        minCandidates = candidateCount;
-                        row = r;
-                        col = c;
-                        found = true;
-                        if (candidateCount == 1) return found; // Best possible
-                    }
-                }
+                if (board(r, c) == EMPTY) return false;
             }
         }
-        return found;
+        return true;
+    }
+
+    // Solve grid in place with the selected engine
+    bool solveGrid(Grid& grid, SearchStats* stats = nullptr) {
+        return solver.solve(grid, stats);
     }
 
-    std::vector<int> getCandidates(const std::vector<std::vector<int>>& grid, int row, int col) {
+    std::vector<int> getCandidates(const Grid& grid, int row, int col) const {
         std::vector<int> candidates;
-        for (int num = 1; num <= SIZE; ++num) {
-            if (isValidInGrid(grid, row, col, num)) {
-                candidates.push_back(num);
-            }
+        DigitMask mask = ALL_DIGITS & ~usedDigits(grid, row, col);
+        for (; mask; mask &= mask - 1) {
+            candidates.push_back(lowestDigit(mask));
         }
         return candidates;
     }
 
-    bool isValidInGrid(const std::vector<std::vector<int>>& grid, int row, int col, int num) const {
-        // Check row
-        for (int c = 0; c < SIZE; ++c) {
-            if (c != col && grid[row][c] == num) return false;
+    // Digits already used by the row, column and box peers of a cell, in one pass
+    DigitMask usedDigits(const Grid& grid, int row, int col) const {
+        DigitMask used = 0;
+        for (int i = 0; i < SIZE; ++i) {
+            if (i != col && grid(row, i) != EMPTY) used |= digitBit(grid(row, i));
+            if (i != row && grid(i, col) != EMPTY) used |= digitBit(grid(i, col));
         }
         
-        // Check column
-        for (int r = 0; r < SIZE; ++r) {
-            if (r != row && grid[r][col] == num) return false;
-        }
-        
-        // Check 3x3 box
-        int boxRow = (row / 3) * 3;
-        int boxCol = (col / 3) * 3;
-        for (int r = boxRow; r < boxRow + 3; ++r) {
-            for (int c = boxCol; c < boxCol + 3; ++c) {
-                if ((r != row || c != col) && grid[r][c] == num) return false;
+        int boxRow = (row / BOX_SIZE) * BOX_SIZE;
+        int boxCol = (col / BOX_SIZE) * BOX_SIZE;
+        for (int r = boxRow; r < boxRow + BOX_SIZE; ++r) {
+            for (int c = boxCol; c < boxCol + BOX_SIZE; ++c) {
+                if ((r != row || c != col) && grid(r, c) != EMPTY) used |= digitBit(grid(r, c));
             }
         }
-        
-        return true;
+        return used;
     }
 
-    // Generate a complete valid Sudoku solution
+    // Generate a complete valid Sudoku solution, unrelated to the current
+    // puzzle, whose own solution is then solved again on demand
     bool generateSolution() {
-        solution.assign(SIZE, std::vector<int>(SIZE, EMPTY));
-        return solveBacktrack(solution);
+        solutionState = SOLUTION_UNKNOWN;
+        return generator.generateSolution(solution);
+    }
+
+    // Create the puzzle keyed by (seed, difficulty); see Generator::createPuzzle
+    bool createPuzzle(Difficulty difficulty, uint64_t seed) {
+        setSeed(seed);
+        return createPuzzle(difficulty);
     }
 
     // Create puzzle by removing numbers from solution
-    void createPuzzle(Difficulty difficulty) {
-        if (!generateSolution()) {
-            throw std::runtime_error("Failed to generate solution");
+    bool createPuzzle(Difficulty difficulty) {
+        if (!generator.createPuzzle(difficulty, board, solution)) {
+            solutionState = SOLUTION_UNKNOWN;
+            return false;
         }
+        startPuzzle();
+        return true;
+    }
+
+    // Start a pooled puzzle of the given difficulty; false if there is no
+    // pool or it has none ready
+    bool takePooledPuzzle(Difficulty difficulty) {
+        if (pool == nullptr || !pool->take(difficulty, board, solution)) return false;
+        startPuzzle();
+        return true;
+    }
+
+    // Take a random puzzle of the given difficulty from the corpus. Returns
+    // false, leaving the game untouched, if there is no corpus, it has no
+    // puzzles of that difficulty, or the drawn record is corrupt.
+    bool drawPuzzle(Difficulty difficulty) {
+        size_t first, count;
+        if (corpus == nullptr || !corpus->section(difficulty, first, count)) return false;
         
-        board = solution;
-        fixed.assign(SIZE, std::vector<bool>(SIZE, true));
-        
-        std::vector<std::pair<int, int>> positions;
-        for (int r = 0; r < SIZE; ++r) {
-            for (int c = 0; c < SIZE; ++c) {
-                positions.emplace_back(r, c);
-            }
+        Grid puzzle, solved;
+        CandidateMasks masks;
+        size_t pick = first + static_cast<size_t>(drawRng() % count);
+        if (!corpus->read(pick, puzzle, solved) || !isCompleteSolution(solved) ||
+            !masks.load(puzzle)) {
+            return false;
         }
         
-        std::shuffle(positions.begin(), positions.end(), rng);
-        
-        int targetClues = difficulty + std::uniform_int_distribution<int>(0, 5)(rng);
-        int cellsToRemove = SIZE * SIZE - targetClues;
+        board = puzzle;
+        solution = solved;
+        startPuzzle();
+        return true;
+    }
+
+    // Start from an externally supplied puzzle; its filled cells become the
+    // givens. Returns false (leaving the game untouched) if it has no solution.
+    bool loadPuzzle(const Grid& puzzle) {
+        Grid solved = puzzle;
+        if (!solveGrid(solved)) return false;
         
-        for (int i = 0; i < cellsToRemove && i < positions.size(); ++i) {
-            int row = positions[i].first;
-            int col = positions[i].second;
-            
-            int backup = board[row][col];
-            board[row][col] = EMPTY;
-            fixed[row][col] = false;
-            
-            // Ensure puzzle still has unique solution
-            if (!hasUniqueSolution()) {
-                board[row][col] = backup;
-                fixed[row][col] = true;
-            }
-        }
+        board = puzzle;
+        solution = solved;
+        startPuzzle();
+        return true;
     }
 
     // Check if puzzle has unique solution
     bool hasUniqueSolution() {
-        std::vector<std::vector<int>> testGrid = board;
-        int solutionCount = 0;
-        countSolutions(testGrid, solutionCount, 2);
-        return solutionCount == 1;
+        return solver.hasUniqueSolution(board);
     }
 
-    void countSolutions(std::vector<std::vector<int>>& grid, int& count, int limit) {
+    void countSolutions(const Grid& grid, int& count, int limit, SearchStats* stats = nullptr) {
         if (count >= limit) return;
-        
-        int row, col;
-        if (!findBestCell(grid, row, col)) {
-            count++;
-            return;
-        }
-
-        std::vector<int> candidates = getCandidates(grid, row, col);
-        for (int num : candidates) {
-            if (count >= limit) return;
-            grid[row][col] = num;
-            countSolutions(grid, count, limit);
-            grid[row][col] = EMPTY;
-        }
+        count += solver.countSolutions(grid, limit - count, stats);
     }
 
     // AI Solver - returns next best move
@@ -237,14 +527,11 @@ public:
             return logicalMove;
         }
         
-        // Fall back to backtracking
-        std::vector<std::vector<int>> tempBoard = board;
-        if (solveBacktrack(tempBoard)) {
-            for (int r = 0; r < SIZE; ++r) {
-                for (int c = 0; c < SIZE; ++c) {
-                    if (board[r][c] == EMPTY) {
-                        return Move(r, c, tempBoard[r][c]);
-                    }
+        // Fall back to the puzzle's solution
+        if (ensureSolution()) {
+            for (int i = 0; i < CELL_COUNT; ++i) {
+                if (board.cells[i] == EMPTY) {
+                    return Move(i / SIZE, i % SIZE, solution.cells[i]);
                 }
             }
         }
@@ -252,66 +539,61 @@ public:
         return Move(-1, -1, -1); // No move found
     }
 
-    // Logical solving strategies
+    // Candidates of a board cell, straight from the live board masks
+    DigitMask cellCandidates(int row, int col) const {
+        return board(row, col) == EMPTY ? boardMasks.candidates(row, col) : 0;
+    }
+
+    DigitMask cellCandidates(int cell) const {
+        return cellCandidates(cell / SIZE, cell % SIZE);
+    }
+
+    // Logical solving strategies: singles straight from the live board
+    // masks, then, only when there are none, the first placement
+    // BasicLogicalSolver finds with locked candidates, subsets and fish
     Move getLogicalMove() {
         // Strategy 1: Naked Singles (cells with only one candidate)
-        for (int r = 0; r < SIZE; ++r) {
-            for (int c = 0; c < SIZE; ++c) {
-                if (board[r][c] == EMPTY) {
-                    std::vector<int> candidates = getCandidates(board, r, c);
-                    if (candidates.size() == 1) {
-                        return Move(r, c, candidates[0]);
-                    }
-                }
+        for (int i = 0; i < CELL_COUNT; ++i) {
+            DigitMask candidates = cellCandidates(i);
+            if (candidates != 0 && (candidates & (candidates - 1)) == 0) {
+                return Move(i / SIZE, i % SIZE, lowestDigit(candidates));
             }
         }
         
-        // Strategy 2: Hidden Singles (numbers that can only go in one place)
-        for (int num = 1; num <= SIZE; ++num) {
-            // Check rows
-            for (int r = 0; r < SIZE; ++r) {
-                std::vector<int> possibleCols;
-                for (int c = 0; c < SIZE; ++c) {
-                    if (board[r][c] == EMPTY && isValidMove(r, c, num)) {
-                        possibleCols.push_back(c);
-                    }
-                }
-                if (possibleCols.size() == 1) {
-                    return Move(r, possibleCols[0], num);
-                }
-            }
-            
-            // Check columns
-            for (int c = 0; c < SIZE; ++c) {
-                std::vector<int> possibleRows;
-                for (int r = 0; r < SIZE; ++r) {
-                    if (board[r][c] == EMPTY && isValidMove(r, c, num)) {
-                        possibleRows.push_back(r);
-                    }
-                }
-                if (possibleRows.size() == 1) {
-                    return Move(possibleRows[0], c, num);
-                }
+        // Strategy 2: Hidden Singles (numbers that can only go in one place).
+        // For each unit, collect the digits that are a candidate in exactly one cell.
+        const UnitTable& units = unitTable();
+        DigitMask hidden[UNIT_COUNT];
+        for (int u = 0; u < UNIT_COUNT; ++u) {
+            DigitMask once = 0, twice = 0;
+            for (int k = 0; k < SIZE; ++k) {
+                DigitMask candidates = cellCandidates(units.cells[u][k]);
+                twice |= once & candidates;
+                once |= candidates;
             }
-            
-            // Check boxes
-            for (int boxR = 0; boxR < 3; ++boxR) {
-                for (int boxC = 0; boxC < 3; ++boxC) {
-                    std::vector<std::pair<int, int>> possibleCells;
-                    for (int r = boxR * 3; r < (boxR + 1) * 3; ++r) {
-                        for (int c = boxC * 3; c < (boxC + 1) * 3; ++c) {
-                            if (board[r][c] == EMPTY && isValidMove(r, c, num)) {
-                                possibleCells.emplace_back(r, c);
-                            }
-                        }
-                    }
-                    if (possibleCells.size() == 1) {
-                        return Move(possibleCells[0].first, possibleCells[0].second, num);
+            hidden[u] = once & ~twice;
+        }
+        
+        for (int num = 1; num <= SIZE; ++num) {
+            DigitMask bit = digitBit(num);
+            // Units run rows, then columns, then boxes
+            for (int u = 0; u < UNIT_COUNT; ++u) {
+                if (!(hidden[u] & bit)) continue;
+                for (int k = 0; k < SIZE; ++k) {
+                    int cell = units.cells[u][k];
+                    if (cellCandidates(cell) & bit) {
+                        return Move(cell / SIZE, cell % SIZE, num);
                     }
                 }
             }
         }
         
+        // Strategy 3: the full technique chain, which rebuilds its pencil marks
+        int cell, num;
+        Technique used;
+        if (logic.nextPlacement(board, cell, num, used)) {
+            return Move(cell / SIZE, cell % SIZE, num);
+        }
         return Move(-1, -1, -1); // No logical move found
     }
 
@@ -323,24 +605,19 @@ public:
         }
         
         // Find cell with minimum candidates for hint
-        int bestRow = -1, bestCol = -1;
+        int bestCell = -1;
         int minCandidates = SIZE + 1;
         
-        for (int r = 0; r < SIZE; ++r) {
-            for (int c = 0; c < SIZE; ++c) {
-                if (board[r][c] == EMPTY) {
-                    std::vector<int> candidates = getCandidates(board, r, c);
-                    if (candidates.size() < minCandidates && candidates.size() > 0) {
-                        minCandidates = candidates.size();
-                        bestRow = r;
-                        bestCol = c;
-                    }
-                }
+        for (int i = 0; i < CELL_COUNT; ++i) {
+            int candidateCount = countDigits(cellCandidates(i));
+            if (candidateCount > 0 && candidateCount < minCandidates) {
+                minCandidates = candidateCount;
+                bestCell = i;
             }
         }
         
-        if (bestRow != -1 && bestCol != -1) {
-            return Move(bestRow, bestCol, solution[bestRow][bestCol]);
+        if (bestCell != -1 && ensureSolution()) {
+            return Move(bestCell / SIZE, bestCell % SIZE, solution.cells[bestCell]);
         }
         
         return Move(-1, -1, -1);
@@ -352,102 +629,52 @@ public:
             return Move(-1, -1, -1);
         }
         
-        if (board[row][col] != EMPTY) {
+        if (board(row, col) != EMPTY) {
             return Move(-1, -1, -2); // Cell already filled
         }
         
-        if (fixed[row][col]) {
+        if (fixed[cellIndex(row, col)]) {
             return Move(-1, -1, -3); // Fixed cell
         }
         
         // Return the correct value from solution
-        return Move(row, col, solution[row][col]);
+        if (!ensureSolution()) return Move(-1, -1, -1);
+        return Move(row, col, solution(row, col));
     }
 
     // Player move
     bool makeMove(int row, int col, int value) {
-        try {
-            if (row < 0 || row >= SIZE || col < 0 || col >= SIZE) {
-                throw std::out_of_range("Position out of bounds");
-            }
-            
-            if (fixed[row][col]) {
-                throw std::invalid_argument("Cannot modify fixed cell");
-            }
-            
-            if (value < 0 || value > SIZE) {
-                throw std::invalid_argument("Invalid value");
-            }
-            
-            if (value == EMPTY) {
-                board[row][col] = EMPTY;
-                return true;
-            }
-            
-            if (!isValidMove(row, col, value)) {
-                throw std::invalid_argument("Invalid move - conflicts with Sudoku rules");
-            }
-            
-            board[row][col] = value;
-            return true;
-            
-        } catch (const std::exception& e) {
-            std::cerr << "Error: " << e.what() << std::endl;
+        MoveResult result = applyMove(row, col, value);
+        if (result != MOVE_OK) {
+            std::cerr << "Error: " << moveResultMessage(result) << "\n";
             return false;
         }
+        return true;
     }
 
-    // Auto-solve the puzzle
+    // Auto-solve the puzzle, replacing any wrong player moves, as one
+    // journal step. Wrong entries are cleared before anything is filled,
+    // so no state along the way (or its undo) repeats a digit in a unit,
+    // which the masks could not represent.
     bool solvePuzzle() {
-        return solveBacktrack(board);
-    }
-
-    // Display functions
-    void displayBoard() const {
-        std::cout << "\n   ";
-        for (int c = 0; c < SIZE; ++c) {
-            std::cout << " " << (c + 1) << " ";
-            if ((c + 1) % 3 == 0 && c < SIZE - 1) std::cout << "|";
-        }
-        std::cout << "\n  +";
-        for (int c = 0; c < SIZE; ++c) {
-            std::cout << "---";
-            if ((c + 1) % 3 == 0 && c < SIZE - 1) std::cout << "+";
-        }
-        std::cout << "+\n";
-        
-        for (int r = 0; r < SIZE; ++r) {
-            std::cout << (r + 1) << " |";
-            for (int c = 0; c < SIZE; ++c) {
-                if (board[r][c] == EMPTY) {
-                    std::cout << " . ";
-                } else {
-                    if (fixed[r][c]) {
-                        std::cout << " " << board[r][c] << " ";
-                    } else {
-                        std::cout << "[" << board[r][c] << "]";
-                    }
-                }
-                if ((c + 1) % 3 == 0 && c < SIZE - 1) std::cout << "|";
-            }
-            std::cout << "|\n";
-            
-            if ((r + 1) % 3 == 0 && r < SIZE - 1) {
-                std::cout << "  +";
-                for (int c = 0; c < SIZE; ++c) {
-                    std::cout << "---";
-                    if ((c + 1) % 3 == 0 && c < SIZE - 1) std::cout << "+";
+        if (!ensureSolution()) return false;
+        bool joined = false;
+        for (int pass = 0; pass < 2; ++pass) {
+            for (int i = 0; i < CELL_COUNT; ++i) {
+                if (board.cells[i] == solution.cells[i] || (pass == 0) == (board.cells[i] == EMPTY)) {
+                    continue;
                 }
-                std::cout << "+\n";
+                playCell(i, pass == 0 ? EMPTY : solution.cells[i], joined);
+                joined = true;
             }
         }
-        std::cout << "  +";
-        for (int c = 0; c < SIZE; ++c) {
-            std::cout << "---";
-            if ((c + 1) % 3 == 0 && c < SIZE - 1) std::cout << "+";
-        }
-        std::cout << "+\n";
-        std::cout << "Legend: . = empty, [n] = your move, n = given\n\n";
+        return true;
+    }
+
+    // Display functions
+    void displayBoard() {
+        appendBoard();
+        frame.flush();
     }
 
     void showCandidates(int row, int col) {
@@ -456,38 +683,29 @@ public:
             return;
         }
         
-        if (board[row][col] != EMPTY) {
-            std::cout << "Cell (" << (row + 1) << "," << (col + 1) << ") already has value " << board[row][col] << "\n";
+        if (board(row, col) != EMPTY) {
+            std::cout << "Cell (" << (row + 1) << "," << (col + 1) << ") already has value " << int(board(row, col)) << "\n";
             return;
         }
         
-        std::vector<int> candidates = getCandidates(board, row, col);
         std::cout << "Possible values for cell (" << (row + 1) << "," << (col + 1) << "): ";
-        for (size_t i = 0; i < candidates.size(); ++i) {
-            std::cout << candidates[i];
-            if (i < candidates.size() - 1) std::cout << ", ";
+        for (DigitMask mask = cellCandidates(row, col); mask; mask &= mask - 1) {
+            std::cout << lowestDigit(mask);
+            if (mask & (mask - 1)) std::cout << ", ";
         }
         std::cout << "\n";
     }
 
-    void showStatistics() const {
-        int filled = 0, given = 0, playerMoves = 0;
-        for (int r = 0; r < SIZE; ++r) {
-            for (int c = 0; c < SIZE; ++c) {
-                if (board[r][c] != EMPTY) {
-                    filled++;
-                    if (fixed[r][c]) given++;
-                    else playerMoves++;
-                }
-            }
-        }
-        
-        std::cout << "Statistics:\n";
-        std::cout << "  Given clues: " << given << "\n";
-        std::cout << "  Your moves: " << playerMoves << "\n";
-        std::cout << "  Total filled: " << filled << "/" << (SIZE * SIZE) << "\n";
-        std::cout << "  Completion: " << std::fixed << std::setprecision(1) 
-                  << (100.0 * filled / (SIZE * SIZE)) << "%\n\n";
+    void showStatistics() {
+        appendStatistics();
+        frame.flush();
+    }
+
+    // Compact mode: a shorter board, statistics on one line, command help
+    // only on the first frame and on '?', and the board redrawn only when
+    // it changed since the last frame
+    void setCompact(bool enabled) {
+        compact = enabled;
     }
 
     std::string getDifficultyName(int diff) const {
@@ -527,30 +745,21 @@ public:
             default: diff = MEDIUM; break;
         }
         
+        if (drawPuzzle(diff)) {
+            std::cout << "Loaded " << getDifficultyName(diff) << " puzzle from the corpus.\n";
+            return;
+        }
+        if (takePooledPuzzle(diff)) {
+            std::cout << "New puzzle generated successfully!\n";
+            return;
+        }
+        
         std::cout << "Generating " << getDifficultyName(diff) << " puzzle...\n";
         
-        try {
-            createPuzzle(diff);
+        if (createPuzzle(diff)) {
             std::cout << "New puzzle generated successfully!\n";
-        } catch (const std::exception& e) {
-            std::cerr << "Error generating puzzle: " << e.what() << std::endl;
-            // Fallback to a simpler generation method
-            generateSolution();
-            board = solution;
-            fixed.assign(SIZE, std::vector<bool>(SIZE, true));
-            // Remove some cells randomly as fallback
-            std::vector<std::pair<int, int>> positions;
-            for (int r = 0; r < SIZE; ++r) {
-                for (int c = 0; c < SIZE; ++c) {
-                    positions.emplace_back(r, c);
-                }
-            }
-            std::shuffle(positions.begin(), positions.end(), rng);
-            int toRemove = SIZE * SIZE - diff;
-            for (int i = 0; i < toRemove && i < positions.size(); ++i) {
-                board[positions[i].first][positions[i].second] = EMPTY;
-                fixed[positions[i].first][positions[i].second] = false;
-            }
+        } else {
+            std::cout << "Error generating puzzle. Please try again.\n";
         }
     }
 
@@ -561,12 +770,16 @@ public:
         newGame();
         
         while (true) {
-            displayBoard();
-            showStatistics();
+            bool changed = board != drawn;
+            if (!compact || changed || helpWanted) {
+                appendBoard();
+                appendStatistics();
+            }
             
             if (isComplete()) {
-                std::cout << "🎉 Congratulations! Puzzle solved! 🎉\n";
-                std::cout << "Start a new game? (y/n): ";
+                frame.append("🎉 Congratulations! Puzzle solved! 🎉\n");
+                frame.append("Start a new game? (y/n): ");
+                frame.flush();
                 char choice;
                 std::cin >> choice;
                 if (choice == 'y' || choice == 'Y') {
@@ -577,16 +790,10 @@ public:
                 }
             }
             
-            std::cout << "Commands:\n";
-            std::cout << "  m <row> <col> <value> - Make move (1-9, use 0 to clear)\n";
-            std::cout << "  h <row> <col>         - Get hint for specific cell\n";
-            std::cout << "  g                     - Get general hint (best move)\n";
-            std::cout << "  c <row> <col>         - Show candidates for cell\n";
-            std::cout << "  n                     - Get next move suggestion\n";
-            std::cout << "  s                     - Auto-solve puzzle\n";
-            std::cout << "  r                     - Restart puzzle\n";
-            std::cout << "  q                     - Quit game\n";
-            std::cout << "\nEnter command: ";
+            if (!compact || helpWanted) appendHelp();
+            helpWanted = false;
+            frame.append(compact ? "> " : "\nEnter command: ");
+            frame.flush();
             
             char cmd;
             std::cin >> cmd;
@@ -676,10 +883,27 @@ public:
                     }
                     break;
                 }
+                case 'u': {
+                    if (!undo()) std::cout << "Nothing to undo.\n\n";
+                    break;
+                }
+                case 'y': {
+                    if (!redo()) std::cout << "Nothing to redo.\n\n";
+                    break;
+                }
                 case 'r': {
+                    restart();
+                    std::cout << "Puzzle restarted.\n\n";
+                    break;
+                }
+                case 'p': {
                     newGame();
                     break;
                 }
+                case '?': {
+                    helpWanted = true;
+                    break;
+                }
                 case 'q': {
                     std::cout << "Thanks for playing!\n";
                     return;
@@ -692,16 +916,1598 @@ public:
             }
         }
     }
-};
 
-int main() {
-    try {
-        SudokuGame game;
-        game.gameLoop();
-    } catch (const std::exception& e) {
-        std::cerr << "Fatal error: " << e.what() << std::endl;
-        return 1;
+private:
+    static const uint32_t SNAPSHOT_VERSION = 1;
+    static const int PERMUTATION_BITS = 19;     // 9! < 2^19
+    static const int DELTA_BITS = 12;
+    static const size_t MAX_SNAPSHOT_DELTAS = 255;
+    static const uint8_t UNSET_CELL = 0xFF;
+
+    // Rank of a row of the digits 1-9 among all 9! orders (its Lehmer code)
+    static uint32_t rankRow(const uint8_t* row) {
+        uint32_t rank = 0;
+        DigitMask unused = ALL_DIGITS;
+        for (int i = 0; i < SIZE; ++i) {
+            rank = rank * (SIZE - i) + countDigits(unused & (digitBit(row[i]) - 1));
+            unused &= ~digitBit(row[i]);
+        }
+        return rank;
+    }
+
+    // The row with the given rank; false if the rank is out of range
+    static bool unrankRow(uint32_t rank, uint8_t* row) {
+        uint32_t place = 1;
+        for (int i = 2; i < SIZE; ++i) {
+            place *= i;
+        }
+        if (rank >= place * SIZE) return false;
+        DigitMask unused = ALL_DIGITS;
+        for (int i = 0; i < SIZE; ++i) {
+            uint32_t index = rank / place;
+            rank %= place;
+            if (i < SIZE - 1) place /= SIZE - 1 - i;
+            DigitMask pick = unused;
+            for (uint32_t k = 0; k < index; ++k) {
+                pick &= pick - 1;
+            }
+            row[i] = lowestDigit(pick);
+            unused &= ~digitBit(row[i]);
+        }
+        return true;
+    }
+
+    // Take the givens from a freshly set board, whose solution is already
+    // in solution
+    void startPuzzle() {
+        for (int i = 0; i < CELL_COUNT; ++i) {
+            fixed[i] = board.cells[i] != EMPTY;
+        }
+        boardMasks.load(board);
+        solutionState = SOLUTION_KNOWN;
+        journal.clear();
+        applied = 0;
+    }
+
+    // Make solution hold the solution of the givens, solving them only the
+    // first time after the puzzle changes. Returns false if they have none.
+    bool ensureSolution() {
+        if (solutionState == SOLUTION_UNKNOWN) {
+            Grid givens;
+            for (int i = 0; i < CELL_COUNT; ++i) {
+                if (fixed[i]) givens.cells[i] = board.cells[i];
+            }
+            solutionState = solveGrid(givens) ? SOLUTION_KNOWN : SOLUTION_NONE;
+            if (solutionState == SOLUTION_KNOWN) solution = givens;
+        }
+        return solutionState == SOLUTION_KNOWN;
+    }
+
+    // Append the board to frame, and remember it as the board last drawn
+    void appendBoard() {
+        frame.append("\n   ");
+        for (int c = 0; c < SIZE; ++c) {
+            frame.append(' ');
+            frame.appendNumber(c + 1);
+            frame.append(' ');
+            if ((c + 1) % 3 == 0 && c < SIZE - 1) frame.append('|');
+        }
+        frame.append('\n');
+        appendBoxRule();
+        
+        for (int r = 0; r < SIZE; ++r) {
+            frame.appendNumber(r + 1);
+            frame.append(" |");
+            for (int c = 0; c < SIZE; ++c) {
+                char digit = digitSymbol(board(r, c));
+                if (board(r, c) == EMPTY) {
+                    frame.append(" . ");
+                } else if (fixed[cellIndex(r, c)]) {
+                    frame.append(' ');
+                    frame.append(digit);
+                    frame.append(' ');
+                } else {
+                    frame.append('[');
+                    frame.append(digit);
+                    frame.append(']');
+                }
+                if ((c + 1) % 3 == 0 && c < SIZE - 1) frame.append('|');
+            }
+            frame.append("|\n");
+            if ((r + 1) % 3 == 0 && r < SIZE - 1) appendBoxRule();
+        }
+        appendBoxRule();
+        if (!compact) frame.append("Legend: . = empty, [n] = your move, n = given\n\n");
+        drawn = board;
+    }
+
+    void appendBoxRule() {
+        frame.append("  +");
+        for (int c = 0; c < SIZE; ++c) {
+            frame.append("---");
+            if ((c + 1) % 3 == 0 && c < SIZE - 1) frame.append('+');
+        }
+        frame.append("+\n");
+    }
+
+    void appendStatistics() {
+        int filled = 0, given = 0;
+        for (int i = 0; i < CELL_COUNT; ++i) {
+            if (board.cells[i] != EMPTY) {
+                filled++;
+                if (fixed[i]) given++;
+            }
+        }
+        
+        char line[160];
+        if (compact) {
+            std::snprintf(line, sizeof(line), "Given %d, moves %d, filled %d/%d (%.1f%%)\n",
+                          given, filled - given, filled, CELL_COUNT, 100.0 * filled / CELL_COUNT);
+        } else {
+            std::snprintf(line, sizeof(line),
+                          "Statistics:\n  Given clues: %d\n  Your moves: %d\n  Total filled: %d/%d\n"
+                          "  Completion: %.1f%%\n\n",
+                          given, filled - given, filled, CELL_COUNT, 100.0 * filled / CELL_COUNT);
+        }
+        frame.append(line);
+    }
+
+    void appendHelp() {
+        frame.append("Commands:\n"
+                     "  m <row> <col> <value> - Make move (1-9, use 0 to clear)\n"
+                     "  h <row> <col>         - Get hint for specific cell\n"
+                     "  g                     - Get general hint (best move)\n"
+                     "  c <row> <col>         - Show candidates for cell\n"
+                     "  n                     - Get next move suggestion\n"
+                     "  s                     - Auto-solve puzzle\n"
+                     "  u                     - Undo last move\n"
+                     "  y                     - Redo move\n"
+                     "  r                     - Restart puzzle\n"
+                     "  p                     - New puzzle\n"
+                     "  ?                     - Show these commands\n"
+                     "  q                     - Quit game\n");
+    }
+
+    // Write one cell through the journal; joined makes it part of the same
+    // step as the previous delta
+    void playCell(int cell, int value, bool joined) {
+        int previous = board.cells[cell];
+        if (previous == value) return;
+        journal.erase(journal.begin() + applied, journal.end());
+        Delta delta = {static_cast<uint8_t>(cell), static_cast<uint8_t>(previous),
+                       static_cast<uint8_t>(value), joined};
+        journal.push_back(delta);
+        ++applied;
+        setCell(cell / SIZE, cell % SIZE, value);
+    }
+
+    // Write one cell, keeping boardMasks in step
+    void setCell(int row, int col, int value) {
+        int previous = board(row, col);
+        if (previous != EMPTY) boardMasks.unplace(row, col, previous);
+        board(row, col) = value;
+        if (value != EMPTY) boardMasks.place(row, col, value);
+    }
+};
+
+const size_t SudokuGame::SNAPSHOT_SIZE;
+const size_t SudokuGame::MAX_SNAPSHOT_DELTAS;
+
+// Output accumulated in one buffer and handed to fwrite in large chunks
+class BufferedWriter {
+public:
+    explicit BufferedWriter(FILE* file, size_t capacity = 1 << 16)
+        : out(file), limit(capacity) {
+        buffer.reserve(capacity + 128);
+    }
+
+    ~BufferedWriter() { flush(); }
+
+    void write(const char* data, size_t length) {
+        buffer.append(data, length);
+        if (buffer.size() >= limit) flush();
+    }
+
+    void writeLine(const char* data, size_t length) {
+        buffer.append(data, length);
+        buffer.push_back('\n');
+        if (buffer.size() >= limit) flush();
+    }
+
+    void flush() {
+        if (!buffer.empty()) {
+            std::fwrite(buffer.data(), 1, buffer.size(), out);
+            buffer.clear();
+        }
+        std::fflush(out);
+    }
+
+private:
+    FILE* out;
+    size_t limit;
+    std::string buffer;
+};
+
+// A whole file in memory: mapped read-only where mmap is available, read
+// into a buffer otherwise
+class MappedFile {
+public:
+    MappedFile() : bytes(nullptr), length(0), mapped(false) {}
+    ~MappedFile() { release(); }
+
+    bool open(const char* path) {
+        release();
+#ifdef SUDOKU_HAVE_MMAP
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED) {
+                bytes = static_cast<const uint8_t*>(view);
+                length = static_cast<size_t>(info.st_size);
+                mapped = true;
+            }
+        }
+        ::close(fd);
+        if (mapped) return true;
+#endif
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        bytes = reinterpret_cast<const uint8_t*>(buffer.data());
+        length = buffer.size();
+        return true;
+    }
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    void release() {
+#ifdef SUDOKU_HAVE_MMAP
+        if (mapped) munmap(const_cast<uint8_t*>(bytes), length);
+#endif
+        bytes = nullptr;
+        length = 0;
+        mapped = false;
+        buffer.clear();
+    }
+
+    const uint8_t* bytes;
+    size_t length;
+    bool mapped;
+    std::vector<char> buffer;
+};
+
+// Puzzles for the batch solvers, one per text line. Blank lines and lines
+// starting with '#' are skipped.
+template <int BOX>
+class LineSource {
+public:
+    explicit LineSource(std::istream& input) : in(input) {}
+
+    // Fetch the next puzzle into grid, with parsed false for a malformed
+    // line; returns false at the end of the input
+    bool next(BasicGrid<BOX>& grid, bool& parsed) {
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#' || line == "\r") continue;
+            parsed = parseGrid(line.data(), line.size(), grid);
+            return true;
+        }
+        return false;
+    }
+
+private:
+    std::istream& in;
+    std::string line;
+};
+
+// Puzzles for the batch solvers from a binary corpus, in record order
+template <int BOX>
+class CorpusSource {
+public:
+    explicit CorpusSource(const BasicCorpusView<BOX>& puzzles) : corpus(puzzles), index(0) {}
+
+    bool next(BasicGrid<BOX>& grid, bool& parsed) {
+        if (index >= corpus.size()) return false;
+        BasicGrid<BOX> solution;
+        parsed = corpus.read(index++, grid, solution);
+        return true;
+    }
+
+private:
+    const BasicCorpusView<BOX>& corpus;
+    size_t index;
+};
+
+// Headless batch solver for boards with BOX x BOX boxes: one output line
+// per puzzle from source (the solution, "invalid" or "unsolvable"). With
+// withStats each solved or unsolvable line is followed by a tab and the
+// search counters for that puzzle. threads only matters to the PARALLEL
+// engine, which spreads each puzzle over that many threads. With dedup,
+// solutions are cached by canonical form, and a puzzle that is a relabelled
+// or permuted copy of one already solved is answered from the cache (with
+// all-zero counters). Returns the process exit status.
+template <int BOX, typename Source>
+int runBatchSolve(Source& source, SolverEngine engine, bool withStats, bool dedup, int threads) {
+    const int CELL_COUNT = Dimensions<BOX>::CELL_COUNT;
+    BasicSolver<BOX> solver(engine);
+    solver.setThreads(threads);
+    std::unique_ptr<BasicSolutionCache<BOX> > cache(dedup ? new BasicSolutionCache<BOX>() : nullptr);
+    BufferedWriter out(stdout);
+    
+    static const char INVALID[] = "invalid";
+    static const char UNSOLVABLE[] = "unsolvable";
+    
+    long long total = 0, solved = 0;
+    auto start = std::chrono::steady_clock::now();
+    
+    char formatted[CELL_COUNT];
+    BasicGrid<BOX> grid;
+    bool parsed;
+    while (source.next(grid, parsed)) {
+        ++total;
+        if (!parsed) {
+            out.writeLine(INVALID, sizeof(INVALID) - 1);
+            continue;
+        }
+        
+        SearchStats stats;
+        bool found = cache && cache->lookup(grid, grid);
+        if (!found) {
+            found = solver.solve(grid, withStats ? &stats : nullptr);
+            if (found && cache) cache->store(grid);
+        }
+        if (!found) {
+            out.write(UNSOLVABLE, sizeof(UNSOLVABLE) - 1);
+        } else {
+            formatGrid(grid, formatted);
+            out.write(formatted, CELL_COUNT);
+            ++solved;
+        }
+        
+        if (withStats) {
+            char counters[160];
+            int length = std::snprintf(counters, sizeof(counters),
+                "\tnodes=%llu backtracks=%llu depth=%d propagations=%llu select_ns=%llu propagate_ns=%llu",
+                static_cast<unsigned long long>(stats.nodes),
+                static_cast<unsigned long long>(stats.backtracks), stats.maxDepth,
+                static_cast<unsigned long long>(stats.propagations),
+                static_cast<unsigned long long>(stats.selectNanos),
+                static_cast<unsigned long long>(stats.propagateNanos));
+            out.writeLine(counters, static_cast<size_t>(length));
+        } else {
+            out.writeLine("", 0);
+        }
+    }
+    out.flush();
+    
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (cache) {
+        std::fprintf(stderr, "Solved %lld/%lld puzzles (%llu from cache) in %.3f s\n", solved, total,
+                     static_cast<unsigned long long>(cache->hits()), elapsed);
+    } else {
+        std::fprintf(stderr, "Solved %lld/%lld puzzles in %.3f s\n", solved, total, elapsed);
+    }
+    return 0;
+}
+
+// runBatchSolve() for the backtracking engine without per-puzzle stats:
+// the same output, produced by BasicBatchSolver over blocks of
+// SOLVE_BATCH puzzles for throughput
+template <int BOX, typename Source>
+int runBatchSolveInterleaved(Source& source) {
+    const int CELL_COUNT = Dimensions<BOX>::CELL_COUNT;
+    static const size_t SOLVE_BATCH = 4096;
+    static const char INVALID[] = "invalid";
+    static const char UNSOLVABLE[] = "unsolvable";
+    
+    std::unique_ptr<BasicBatchSolver<BOX> > solver(new BasicBatchSolver<BOX>());
+    std::vector<BasicGrid<BOX> > grids(SOLVE_BATCH);
+    std::vector<char> parsed(SOLVE_BATCH);
+    bool valid[SOLVE_BATCH];
+    BufferedWriter out(stdout);
+    
+    long long total = 0, solved = 0;
+    auto start = std::chrono::steady_clock::now();
+    
+    char formatted[CELL_COUNT];
+    bool more = true;
+    while (more) {
+        size_t lines = 0, count = 0;
+        bool ok;
+        while (lines < SOLVE_BATCH && (more = source.next(grids[count], ok))) {
+            parsed[lines] = ok;
+            if (ok) ++count;
+            ++lines;
+        }
+        
+        solved += solver->solve(grids.data(), count, valid);
+        for (size_t i = 0, k = 0; i < lines; ++i) {
+            if (!parsed[i]) {
+                out.writeLine(INVALID, sizeof(INVALID) - 1);
+            } else if (valid[k]) {
+                formatGrid(grids[k++], formatted);
+                out.writeLine(formatted, CELL_COUNT);
+            } else {
+                out.writeLine(UNSOLVABLE, sizeof(UNSOLVABLE) - 1);
+                ++k;
+            }
+        }
+        total += lines;
+    }
+    out.flush();
+    
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "Solved %lld/%lld puzzles in %.3f s\n", solved, total, elapsed);
+    return 0;
+}
+
+// Solve every puzzle of source, through BasicBatchSolver where the engine
+// and options allow
+template <int BOX, typename Source>
+int runSolve(Source& source, SolverEngine engine, bool withStats, bool dedup, int threads) {
+    if (dedup && BOX > 3) {
+        std::fprintf(stderr, "--dedup supports 4x4 and 9x9 boards only\n");
+        return 2;
+    }
+    if (engine == BACKTRACKING && !withStats && !dedup) return runBatchSolveInterleaved<BOX>(source);
+    return runBatchSolve<BOX>(source, engine, withStats, dedup, threads);
+}
+
+// Solve one-line puzzles from in
+template <int BOX>
+int runTextSolve(std::istream& in, SolverEngine engine, bool withStats, bool dedup, int threads) {
+    LineSource<BOX> source(in);
+    return runSolve<BOX>(source, engine, withStats, dedup, threads);
+}
+
+// Solve the puzzles of a mapped binary corpus, in record order
+template <int BOX>
+int runCorpusSolve(const MappedFile& file, SolverEngine engine, bool withStats, bool dedup,
+                   int threads) {
+    BasicCorpusView<BOX> corpus;
+    if (!corpus.attach(file.data(), file.size())) {
+        std::fprintf(stderr, "Malformed corpus\n");
+        return 1;
+    }
+    CorpusSource<BOX> source(corpus);
+    return runSolve<BOX>(source, engine, withStats, dedup, threads);
+}
+
+// Headless verifier for submitted full grids: one grid per input line, one
+// output line per grid, "valid" if it is a complete solution and "invalid"
+// otherwise. A malformed line is verified as an empty grid, so it comes out
+// invalid. Lines are verified in batches of VERIFY_BATCH through
+// verifySolutions(). Blank lines and lines starting with '#' are skipped.
+// Returns the process exit status.
+template <int BOX>
+int runBatchVerify(std::istream& in) {
+    static const size_t VERIFY_BATCH = 4096;
+    static const char VALID[] = "valid";
+    static const char INVALID[] = "invalid";
+    
+    std::vector<BasicGrid<BOX> > grids(VERIFY_BATCH);
+    bool valid[VERIFY_BATCH];
+    BufferedWriter out(stdout);
+    
+    long long total = 0, passed = 0;
+    auto start = std::chrono::steady_clock::now();
+    
+    std::string line;
+    bool more = true;
+    while (more) {
+        size_t count = 0;
+        while (count < VERIFY_BATCH && (more = static_cast<bool>(std::getline(in, line)))) {
+            if (line.empty() || line[0] == '#' || line == "\r") continue;
+            if (!parseGrid(line.data(), line.size(), grids[count])) grids[count].clear();
+            ++count;
+        }
+        
+        passed += verifySolutions(grids.data(), count, valid);
+        for (size_t i = 0; i < count; ++i) {
+            if (valid[i]) {
+                out.writeLine(VALID, sizeof(VALID) - 1);
+            } else {
+                out.writeLine(INVALID, sizeof(INVALID) - 1);
+            }
+        }
+        total += count;
+    }
+    out.flush();
+    
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "Verified %lld/%lld grids valid in %.3f s\n", passed, total, elapsed);
+    return 0;
+}
+
+// Generate count puzzles of each difficulty in levels, in that order, with
+// BOX x BOX boxes across threads workers. Puzzle i of a level is the one
+// keyed by (baseSeed + i, difficulty), so a pack is reproducible from its
+// base seed and any single puzzle can be regenerated on its own. Output is
+// one line per puzzle, or with binary a corpus holding each puzzle with its
+// solution and one section per level. Every worker owns its own generator
+// (and so its own RNG and solver state), claims chunks of puzzle indices,
+// and fills a private buffer per chunk; finished chunks are written in
+// index order, parking any that complete early instead of waiting. With
+// variants above 1, each generated puzzle is followed by variants - 1
+// random transforms of it (see BasicGenerator::createVariant()), keyed by
+// the puzzle's key and their place after it. With dedup, workers also
+// compute each puzzle's canonical form, and a puzzle whose form was
+// already written is dropped, so which puzzles survive does not depend on
+// the thread count.
+template <int BOX>
+int runBatchGenerate(long long count, const std::vector<Difficulty>& levels, Symmetry symmetry,
+                     bool rated, bool dedup, int variants, int threads, uint64_t baseSeed,
+                     bool binary) {
+    typedef BasicCorpusFormat<BOX> Format;
+    const int CELL_COUNT = Dimensions<BOX>::CELL_COUNT;
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+        if (threads <= 0) threads = 1;
+    }
+    
+    if (dedup && (BOX > 3 || binary)) {
+        std::fprintf(stderr, "--dedup supports text output for 4x4 and 9x9 boards only\n");
+        return 2;
+    }
+    
+    long long perLevel = count * variants;
+    long long total = perLevel * static_cast<long long>(levels.size());
+    if (binary) {
+        if (total > 0xFFFFFFFFLL || levels.size() > static_cast<size_t>(CORPUS_SECTIONS)) {
+            std::fprintf(stderr, "Too many puzzles for one corpus\n");
+            return 2;
+        }
+        CorpusSection sections[CORPUS_SECTIONS] = {};
+        for (size_t s = 0; s < levels.size(); ++s) {
+            sections[s].difficulty = levels[s];
+            sections[s].first = static_cast<uint32_t>(perLevel * static_cast<long long>(s));
+            sections[s].count = static_cast<uint32_t>(perLevel);
+        }
+        uint8_t header[Format::HEADER_SIZE];
+        Format::writeHeader(header, static_cast<uint32_t>(total), sections);
+        std::fwrite(header, 1, sizeof(header), stdout);
+    }
+    size_t recordSize = binary ? Format::RECORD_SIZE : CELL_COUNT + 1;
+    
+    static const long long CHUNK_SIZE = 256;
+    long long chunkCount = (total + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    if (chunkCount < threads) threads = static_cast<int>(std::max(chunkCount, 1LL));
+    
+    struct Chunk {
+        std::string block;
+        std::vector<BasicGrid<BOX> > forms;    // Canonical forms, with dedup
+    };
+    
+    std::mutex outputMutex;
+    long long nextChunk = 0;    // Next chunk index to claim
+    long long nextToWrite = 0;  // Next chunk index due on stdout
+    std::map<long long, Chunk> parked;
+    std::unordered_set<BasicGrid<BOX>, BasicGridHash<BOX> > written;
+    long long duplicates = 0;
+    auto start = std::chrono::steady_clock::now();
+    
+    auto worker = [&]() {
+        BasicGenerator<BOX> generator;
+        generator.setSymmetry(symmetry);
+        generator.setRated(rated);
+        BasicCanonicalizer<BOX> canonicalizer;
+        BasicTransform<BOX> transform;
+        BasicGrid<BOX> puzzle, solution;
+        BasicGrid<BOX> base, baseSolution;
+        long long baseIndex = -1;   // Index i / variants of the puzzle in base
+        char formatted[CELL_COUNT];
+        uint8_t record[Format::RECORD_SIZE];
+        
+        while (true) {
+            long long chunk;
+            {
+                std::lock_guard<std::mutex> lock(outputMutex);
+                chunk = nextChunk++;
+            }
+            if (chunk >= chunkCount) break;
+            
+            long long first = chunk * CHUNK_SIZE;
+            long long last = std::min(first + CHUNK_SIZE, total);
+            Chunk output;
+            output.block.reserve(static_cast<size_t>(last - first) * recordSize);
+            if (dedup) output.forms.resize(static_cast<size_t>(last - first));
+            
+            for (long long i = first; i < last; ++i) {
+                Difficulty difficulty = levels[static_cast<size_t>(i / perLevel)];
+                uint64_t key = baseSeed + static_cast<uint64_t>(i % perLevel / variants);
+                int variant = static_cast<int>(i % variants);
+                if (i / variants != baseIndex) {
+                    // Cannot fail: generation always starts from an empty grid
+                    generator.createPuzzle(difficulty, key, base, baseSolution);
+                    baseIndex = i / variants;
+                }
+                if (variant == 0) {
+                    puzzle = base;
+                    solution = baseSolution;
+                } else {
+                    generator.createVariant(base, baseSolution, key + variant * 0x9E3779B97F4A7C15ULL,
+                                            puzzle, solution);
+                }
+                if (binary) {
+                    Format::encode(puzzle, solution, record);
+                    output.block.append(reinterpret_cast<const char*>(record), sizeof(record));
+                } else {
+                    formatGrid(puzzle, formatted);
+                    output.block.append(formatted, CELL_COUNT);
+                    output.block.push_back('\n');
+                }
+                if (dedup) canonicalizer.canonicalize(puzzle, output.forms[i - first], transform);
+            }
+            
+            std::lock_guard<std::mutex> lock(outputMutex);
+            parked[chunk] = std::move(output);
+            for (auto it = parked.begin(); it != parked.end() && it->first == nextToWrite;
+                 it = parked.erase(it), ++nextToWrite) {
+                const Chunk& ready = it->second;
+                if (!dedup) {
+                    std::fwrite(ready.block.data(), 1, ready.block.size(), stdout);
+                    continue;
+                }
+                for (size_t k = 0; k < ready.forms.size(); ++k) {
+                    if (written.insert(ready.forms[k]).second) {
+                        std::fwrite(ready.block.data() + k * recordSize, 1, recordSize, stdout);
+                    } else {
+                        ++duplicates;
+                    }
+                }
+            }
+        }
+    };
+    
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+    std::fflush(stdout);
+    
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "Generated %lld puzzles (seed %llu) on %d threads in %.3f s\n",
+                 total - duplicates, static_cast<unsigned long long>(baseSeed), threads, elapsed);
+    if (duplicates > 0) std::fprintf(stderr, "Dropped %lld duplicates\n", duplicates);
+    return 0;
+}
+
+// Timing summary for one benchmark
+struct BenchResult {
+    std::string name;
+    size_t operations;
+    double totalNanos;
+    double p50Nanos;
+    double p99Nanos;
+    double nodesPerOperation;
+};
+
+// Run op(i) for every i in [0, count): warmup untimed passes, then repeat
+// timed passes with one latency sample per call. setup(i) runs untimed before
+// each call; op returns the search nodes it used, or 0 where that has no meaning.
+template <typename Setup, typename Operation>
+BenchResult runBenchmark(const std::string& name, size_t count, int warmup, int repeat,
+                         Setup setup, Operation op) {
+    for (int pass = 0; pass < warmup; ++pass) {
+        for (size_t i = 0; i < count; ++i) {
+            setup(i);
+            op(i);
+        }
+    }
+    
+    std::vector<double> samples;
+    samples.reserve(count * repeat);
+    uint64_t nodes = 0;
+    for (int pass = 0; pass < repeat; ++pass) {
+        for (size_t i = 0; i < count; ++i) {
+            setup(i);
+            auto start = std::chrono::steady_clock::now();
+            nodes += op(i);
+            auto end = std::chrono::steady_clock::now();
+            samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+        }
+    }
+    
+    BenchResult result;
+    result.name = name;
+    result.operations = samples.size();
+    result.totalNanos = 0;
+    for (size_t i = 0; i < samples.size(); ++i) result.totalNanos += samples[i];
+    std::sort(samples.begin(), samples.end());
+    result.p50Nanos = samples.empty() ? 0 : samples[samples.size() / 2];
+    result.p99Nanos = samples.empty() ? 0 : samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+    result.nodesPerOperation = samples.empty() ? 0 : static_cast<double>(nodes) / samples.size();
+    return result;
+}
+
+// Fixed corpora: generated ones are keyed by seed (see createPuzzle), so every
+// run and every release measures the same puzzles
+static const uint64_t BENCH_SEED = 20240601;
+static const int BENCH_CORPUS_SIZE = 100;
+
+static const char* const BENCH_17_CLUE[] = {
+    "000000010400000000020000000000050407008000300001090000300400200050100000000806000",
+    "000000010400000000020000000000050604008000300001090000300400200050100000000807000",
+    "000000012000035000000600070700000300000400800100000000000120000080000040050000600",
+    "000000012003600000000007000410020000000500300700000600280000040000300500000000000",
+    "000000012008030000000000040120500000000004700060000000507000300000620000000100000",
+    "000000012040050000000009000070600400000100000000000050000087500601000300200000000",
+    "000000012050400000000000030700600400001000000000080000920000800000510700000003000"
+};
+
+// Well-known puzzles that need deep guessing
+static const char* const BENCH_EXTREME[] = {
+    "1....7.9..3..2...8..96..5....53..9...1..8...26....4...3......1..4......7..7...3..",
+    "1.......2.9.4...5...6...7...5.9.3.......7.......85..4.7.....6...3...9.8...2.....1",
+    "8..........36......7..9.2...5...7.......457.....1...3...1....68..85...1..9....4..",
+    "..53.....8......2..7..1.5..4....53...1..7...6..32...8..6.5....9..4....3......97.."
+};
+
+struct BenchCorpus {
+    std::string name;
+    std::vector<Grid> puzzles;
+};
+
+std::vector<BenchCorpus> buildBenchCorpora() {
+    static const Difficulty DIFFICULTIES[] = {
+        EASY, MEDIUM, HARD, EXPERT
+    };
+    static const char* const NAMES[] = {"easy", "medium", "hard", "expert"};
+    
+    std::vector<BenchCorpus> corpora;
+    Generator generator;
+    Grid puzzle, solution;
+    for (int d = 0; d < 4; ++d) {
+        BenchCorpus corpus;
+        corpus.name = NAMES[d];
+        for (int i = 0; i < BENCH_CORPUS_SIZE; ++i) {
+            generator.createPuzzle(DIFFICULTIES[d], BENCH_SEED + i, puzzle, solution);
+            corpus.puzzles.push_back(puzzle);
+        }
+        corpora.push_back(corpus);
+    }
+    
+    BenchCorpus clue17, extreme;
+    clue17.name = "17-clue";
+    extreme.name = "extreme";
+    for (const char* text : BENCH_17_CLUE) {
+        Grid grid;
+        parseGrid(text, CELL_COUNT, grid);
+        clue17.puzzles.push_back(grid);
+    }
+    for (const char* text : BENCH_EXTREME) {
+        Grid grid;
+        parseGrid(text, CELL_COUNT, grid);
+        extreme.puzzles.push_back(grid);
+    }
+    corpora.push_back(clue17);
+    corpora.push_back(extreme);
+    return corpora;
+}
+
+// Benchmark solving, counting, hinting and generation over the fixed corpora.
+// Prints a table, or a JSON document with json set, to stdout.
+int runBenchmarks(int warmup, int repeat, bool json) {
+    std::vector<BenchCorpus> corpora = buildBenchCorpora();
+    std::vector<BenchResult> results;
+    Solver solver;
+    Generator generator;
+    SudokuGame game;
+    volatile int sink = 0;
+    auto noSetup = [](size_t) {};
+    
+    static const SolverEngine ENGINES[] = {BACKTRACKING, DANCING_LINKS};
+    static const char* const ENGINE_NAMES[] = {"backtrack", "dlx"};
+    
+    for (const BenchCorpus& corpus : corpora) {
+        const std::vector<Grid>& puzzles = corpus.puzzles;
+        for (int e = 0; e < 2; ++e) {
+            solver.setEngine(ENGINES[e]);
+            results.push_back(runBenchmark(
+                "solve/" + std::string(ENGINE_NAMES[e]) + "/" + corpus.name,
+                puzzles.size(), warmup, repeat, noSetup,
+                [&](size_t i) -> uint64_t {
+                    Grid grid = puzzles[i];
+                    SearchStats stats;
+                    sink += solver.solve(grid, &stats);
+                    return stats.nodes;
+                }));
+            results.push_back(runBenchmark(
+                "count2/" + std::string(ENGINE_NAMES[e]) + "/" + corpus.name,
+                puzzles.size(), warmup, repeat, noSetup,
+                [&](size_t i) -> uint64_t {
+                    SearchStats stats;
+                    sink += solver.countSolutions(puzzles[i], 2, &stats);
+                    return stats.nodes;
+                }));
+        }
+        results.push_back(runBenchmark(
+            "logical/" + corpus.name, puzzles.size(), warmup, repeat,
+            [&](size_t i) { game.loadPuzzle(puzzles[i]); },
+            [&](size_t) -> uint64_t {
+                sink += game.getLogicalMove().value;
+                return 0;
+            }));
+    }
+    
+    static const Difficulty DIFFICULTIES[] = {
+        EASY, MEDIUM, HARD, EXPERT
+    };
+    static const char* const DIFFICULTY_NAMES[] = {"easy", "medium", "hard", "expert"};
+    Grid puzzle, solution;
+    for (int d = 0; d < 4; ++d) {
+        Difficulty difficulty = DIFFICULTIES[d];
+        results.push_back(runBenchmark(
+            "generate/" + std::string(DIFFICULTY_NAMES[d]), BENCH_CORPUS_SIZE / 4, warmup, repeat, noSetup,
+            [&](size_t i) -> uint64_t {
+                sink += generator.createPuzzle(difficulty, BENCH_SEED + i, puzzle, solution);
+                return 0;
+            }));
+    }
+    
+    if (json) {
+        std::printf("{\n  \"warmup\": %d,\n  \"repeat\": %d,\n  \"benchmarks\": [\n", warmup, repeat);
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchResult& r = results[i];
+            double nanosPerOp = r.totalNanos / r.operations;
+            std::printf("    {\"name\": \"%s\", \"ops\": %zu, \"ns_per_op\": %.1f, \"ops_per_sec\": %.1f, "
+                        "\"p50_ns\": %.1f, \"p99_ns\": %.1f, \"nodes_per_op\": %.2f}%s\n",
+                        r.name.c_str(), r.operations, nanosPerOp, 1e9 / nanosPerOp,
+                        r.p50Nanos, r.p99Nanos, r.nodesPerOperation,
+                        i + 1 < results.size() ? "," : "");
+        }
+        std::printf("  ]\n}\n");
+    } else {
+        std::printf("%-28s %8s %12s %12s %12s %12s %10s\n",
+                    "benchmark", "ops", "ns/op", "ops/s", "p50 ns", "p99 ns", "nodes/op");
+        for (const BenchResult& r : results) {
+            double nanosPerOp = r.totalNanos / r.operations;
+            std::printf("%-28s %8zu %12.0f %12.0f %12.0f %12.0f %10.1f\n",
+                        r.name.c_str(), r.operations, nanosPerOp, 1e9 / nanosPerOp,
+                        r.p50Nanos, r.p99Nanos, r.nodesPerOperation);
+        }
+    }
+    return 0;
+}
+
+// Reference for --stress: plain depth-first search that fills the cell with
+// the fewest candidates, with none of the engines' propagation, trails or
+// lanes. Counts solutions up to limit and copies the first to first, if set.
+int countReference(Grid& grid, CandidateMasks& masks, int limit, Grid* first) {
+    int best = -1;
+    int bestCount = SIZE + 1;
+    for (int i = 0; i < CELL_COUNT && bestCount > 1; ++i) {
+        if (grid.cells[i] != EMPTY) continue;
+        int count = countDigits(masks.candidates(i / SIZE, i % SIZE));
+        if (count < bestCount) {
+            best = i;
+            bestCount = count;
+        }
+    }
+    if (best < 0) {
+        if (first != nullptr) *first = grid;
+        return 1;
+    }
+    
+    int row = best / SIZE, col = best % SIZE;
+    int found = 0;
+    for (DigitMask mask = masks.candidates(row, col); mask && found < limit; mask &= mask - 1) {
+        int num = lowestDigit(mask);
+        grid(row, col) = num;
+        masks.place(row, col, num);
+        found += countReference(grid, masks, limit - found, found == 0 ? first : nullptr);
+        masks.unplace(row, col, num);
+        grid(row, col) = EMPTY;
+    }
+    return found;
+}
+
+// Bit of a cell's digit, or none for an empty cell
+DigitMask cellBit(int num) {
+    return num == EMPTY ? 0 : digitBit(num);
+}
+
+// Candidates of an empty cell by scanning its peers, for checking getCandidates()
+DigitMask scanCandidates(const Grid& grid, int row, int col) {
+    DigitMask used = 0;
+    int boxRow = row - row % BOX_SIZE, boxCol = col - col % BOX_SIZE;
+    for (int k = 0; k < SIZE; ++k) {
+        used |= cellBit(grid(row, k)) | cellBit(grid(k, col)) |
+                cellBit(grid(boxRow + k / BOX_SIZE, boxCol + k % BOX_SIZE));
+    }
+    return ALL_DIGITS & ~used;
+}
+
+// Whether grid is a complete solution, unit by unit with plain loops, for
+// checking isCompleteSolution() and the verifySolutions() kernels
+bool scanSolution(const Grid& grid) {
+    for (int u = 0; u < SIZE; ++u) {
+        DigitMask row = 0, col = 0, box = 0;
+        for (int k = 0; k < SIZE; ++k) {
+            row |= cellBit(grid(u, k));
+            col |= cellBit(grid(k, u));
+            box |= cellBit(grid(u / BOX_SIZE * BOX_SIZE + k / BOX_SIZE, u % BOX_SIZE * BOX_SIZE + k % BOX_SIZE));
+        }
+        // SIZE cells holding SIZE different digits hold each once
+        if (row != ALL_DIGITS || col != ALL_DIGITS || box != ALL_DIGITS) return false;
+    }
+    return true;
+}
+
+// Whether solved is a complete solution that keeps every given of puzzle
+bool solves(const Grid& solved, const Grid& puzzle) {
+    if (!scanSolution(solved)) return false;
+    for (int i = 0; i < CELL_COUNT; ++i) {
+        if (puzzle.cells[i] != EMPTY && solved.cells[i] != puzzle.cells[i]) return false;
+    }
+    return true;
+}
+
+// One stress puzzle with what the reference found: solutions is 0, 1 or
+// 2 (meaning at least two), and solution is the first one found
+struct StressCase {
+    Grid puzzle;
+    Grid solution;
+    int solutions;
+};
+
+struct StressKind {
+    std::string name;
+    std::vector<StressCase> cases;
+};
+
+// An empty cell of puzzle drawn at random, or -1 if the puzzle is full
+int randomEmptyCell(const Grid& puzzle, std::mt19937& rng) {
+    int empty[CELL_COUNT];
+    int count = 0;
+    for (int i = 0; i < CELL_COUNT; ++i) {
+        if (puzzle.cells[i] == EMPTY) empty[count++] = i;
+    }
+    return count == 0 ? -1 : empty[randomBelow(rng, count)];
+}
+
+// Make some empty cell of puzzle dead: fill in its row from solution, then
+// put the cell's own digit into an empty cell of its column where nothing
+// conflicts, leaving the cell no candidates at all. False if no cell works.
+bool killCell(Grid& puzzle, const Grid& solution, std::mt19937& rng) {
+    for (int attempt = 0; attempt < CELL_COUNT; ++attempt) {
+        int cell = randomEmptyCell(puzzle, rng);
+        if (cell < 0) return false;
+        int row = cell / SIZE, col = cell % SIZE;
+        Grid dead = puzzle;
+        for (int c = 0; c < SIZE; ++c) {
+            if (c != col) dead(row, c) = solution(row, c);
+        }
+        CandidateMasks masks;
+        masks.load(dead);
+        int num = solution(row, col);
+        for (int r = 0; r < SIZE; ++r) {
+            if (r / BOX_SIZE == row / BOX_SIZE || dead(r, col) != EMPTY || !masks.canPlace(r, col, num)) continue;
+            dead(r, col) = num;
+            puzzle = dead;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Puzzles for --stress, count of each kind, keyed by seed + i: generated
+// ones of every difficulty; the same with clues taken away, so most have
+// many solutions; contradictions, where one empty cell gets a candidate
+// other than its solution digit; dead cells with no candidates; duplicated
+// givens; and the 17-clue and extreme corpora under random transforms
+std::vector<StressKind> buildStressKinds(long long count, uint64_t seed) {
+    static const Difficulty DIFFICULTIES[] = {EASY, MEDIUM, HARD, EXPERT};
+    static const char* const NAMES[] = {
+        "unique", "multiple", "contradiction", "dead-cell", "invalid", "adversarial"
+    };
+    
+    std::vector<StressKind> kinds(6);
+    for (int k = 0; k < 6; ++k) kinds[k].name = NAMES[k];
+    
+    std::vector<Grid> adversarial;
+    for (const char* text : BENCH_17_CLUE) {
+        Grid grid;
+        parseGrid(text, CELL_COUNT, grid);
+        adversarial.push_back(grid);
+    }
+    for (const char* text : BENCH_EXTREME) {
+        Grid grid;
+        parseGrid(text, CELL_COUNT, grid);
+        adversarial.push_back(grid);
+    }
+    
+    Generator generator;
+    Grid puzzle, solution;
+    for (long long i = 0; i < count; ++i) {
+        uint64_t key = seed + static_cast<uint64_t>(i);
+        generator.createPuzzle(DIFFICULTIES[i % 4], key, puzzle, solution);
+        std::mt19937 rng(static_cast<std::mt19937::result_type>(key ^ (key >> 32)));
+        StressCase unique = {puzzle, solution, 1};
+        kinds[0].cases.push_back(unique);
+        
+        // The empty grid is the extreme of many solutions
+        Grid multiple;
+        if (i > 0) {
+            multiple = puzzle;
+            for (int removed = 4 + randomBelow(rng, 8); removed > 0;) {
+                int cell = randomBelow(rng, CELL_COUNT);
+                if (multiple.cells[cell] != EMPTY) {
+                    multiple.cells[cell] = EMPTY;
+                    --removed;
+                }
+            }
+        }
+        StressCase many = {multiple, Grid(), 0};
+        kinds[1].cases.push_back(many);
+        
+        // The puzzle is unique, so any other digit in any empty cell leaves no solution
+        Grid contradiction = puzzle;
+        CandidateMasks masks;
+        masks.load(contradiction);
+        for (int attempt = 0; attempt < CELL_COUNT; ++attempt) {
+            int cell = randomEmptyCell(contradiction, rng);
+            if (cell < 0) break;
+            DigitMask wrong = masks.candidates(cell / SIZE, cell % SIZE) & ~digitBit(solution.cells[cell]);
+            if (wrong != 0) {
+                contradiction.cells[cell] = lowestDigit(wrong);
+                break;
+            }
+        }
+        StressCase contradictory = {contradiction, Grid(), 0};
+        kinds[2].cases.push_back(contradictory);
+        
+        Grid dead = puzzle;
+        killCell(dead, solution, rng);
+        StressCase deadCell = {dead, Grid(), 0};
+        kinds[3].cases.push_back(deadCell);
+        
+        // Copy a given into an empty cell of its row
+        Grid invalid = puzzle;
+        for (int attempt = 0; attempt < CELL_COUNT; ++attempt) {
+            int cell = randomEmptyCell(invalid, rng);
+            if (cell < 0) break;
+            int row = cell / SIZE;
+            int from = row * SIZE + randomBelow(rng, SIZE);
+            if (invalid.cells[from] != EMPTY) {
+                invalid.cells[cell] = invalid.cells[from];
+                break;
+            }
+        }
+        StressCase duplicated = {invalid, Grid(), 0};
+        kinds[4].cases.push_back(duplicated);
+        
+        Transform transform;
+        transform.randomize(rng);
+        StressCase hard = {Grid(), Grid(), 0};
+        transform.apply(adversarial[i % adversarial.size()], hard.puzzle);
+        kinds[5].cases.push_back(hard);
+    }
+    
+    for (StressKind& kind : kinds) {
+        for (StressCase& test : kind.cases) {
+            Grid work = test.puzzle;
+            CandidateMasks masks;
+            test.solutions = masks.load(work) ? countReference(work, masks, 2, &test.solution) : 0;
+        }
+    }
+    return kinds;
+}
+
+// Totals for one check of one engine over one kind of stress puzzle
+struct StressResult {
+    std::string name;
+    size_t operations;
+    size_t failures;
+    double totalNanos;
+};
+
+// Cross-check every engine against the reference on count puzzles of each
+// stress kind: solving (backtrack, dlx, parallel and the batch solver)
+// must succeed exactly when a solution exists, leave unsolvable grids as
+// given, and match the reference where the solution is unique; counting to
+// two must agree with the reference; logical placements on unique puzzles
+// must match the solution; getCandidates() must agree with a scan of the
+// peers; isCompleteSolution() and the verifySolutions() kernels must
+// agree with a plain scan of the units; and every tryRemove() verdict
+// while carving a solution must match a fresh count. Prints per-check timing like --bench, each failing puzzle to
+// stderr, and returns 1 if anything failed.
+int runStress(long long count, uint64_t seed, int threads, bool json) {
+    static const size_t MAX_REPORTED = 20;
+    std::vector<StressKind> kinds = buildStressKinds(count, seed);
+    std::vector<StressResult> results;
+    Solver solver;
+    solver.setThreads(threads);
+    std::unique_ptr<BasicBatchSolver<BOX_SIZE> > batch(new BasicBatchSolver<BOX_SIZE>());
+    UniquenessChecker checker;
+    LogicalSolver logic;
+    SudokuGame game;
+    size_t reported = 0;
+    char formatted[CELL_COUNT + 1];
+    formatted[CELL_COUNT] = '\0';
+    
+    auto fail = [&](StressResult& result, const Grid& puzzle) {
+        ++result.failures;
+        if (++reported > MAX_REPORTED) return;
+        formatGrid(puzzle, formatted);
+        std::fprintf(stderr, "FAIL %s %s\n", result.name.c_str(), formatted);
+    };
+    
+    // Time op(test) over every case; op returns false on a wrong answer
+    auto check = [&](const std::string& name, const StressKind& kind,
+                     const std::function<bool(const StressCase&)>& op) {
+        StressResult result = {name + "/" + kind.name, kind.cases.size(), 0, 0};
+        for (const StressCase& test : kind.cases) {
+            auto start = std::chrono::steady_clock::now();
+            bool right = op(test);
+            result.totalNanos += std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start).count();
+            if (!right) fail(result, test.puzzle);
+        }
+        results.push_back(result);
+    };
+    
+    // Judge a solve() outcome against the reference
+    auto judge = [](const StressCase& test, bool solved, const Grid& grid) {
+        if (!solved) return test.solutions == 0 && grid == test.puzzle;
+        if (test.solutions == 0 || !solves(grid, test.puzzle)) return false;
+        return test.solutions > 1 || grid == test.solution;
+    };
+    
+    static const SolverEngine ENGINES[] = {BACKTRACKING, DANCING_LINKS, PARALLEL};
+    static const char* const ENGINE_NAMES[] = {"backtrack", "dlx", "parallel"};
+    
+    for (const StressKind& kind : kinds) {
+        for (int e = 0; e < 3; ++e) {
+            solver.setEngine(ENGINES[e]);
+            check("solve/" + std::string(ENGINE_NAMES[e]), kind, [&](const StressCase& test) {
+                Grid grid = test.puzzle;
+                return judge(test, solver.solve(grid), grid);
+            });
+            check("count2/" + std::string(ENGINE_NAMES[e]), kind, [&](const StressCase& test) {
+                return solver.countSolutions(test.puzzle, 2) == test.solutions;
+            });
+        }
+        
+        // The batch solver is timed over the whole kind at once
+        StressResult result = {"solve/batch/" + kind.name, kind.cases.size(), 0, 0};
+        std::vector<Grid> grids(kind.cases.size());
+        std::unique_ptr<bool[]> solved(new bool[grids.size()]);
+        for (size_t i = 0; i < grids.size(); ++i) grids[i] = kind.cases[i].puzzle;
+        auto start = std::chrono::steady_clock::now();
+        batch->solve(grids.data(), grids.size(), solved.get());
+        result.totalNanos = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count();
+        for (size_t i = 0; i < grids.size(); ++i) {
+            if (!judge(kind.cases[i], solved[i], grids[i])) fail(result, kind.cases[i].puzzle);
+        }
+        results.push_back(result);
+        
+        check("logical", kind, [&](const StressCase& test) {
+            if (test.solutions != 1) return true;
+            Grid board = test.puzzle;
+            int cell, num;
+            Technique hardest;
+            while (logic.nextPlacement(board, cell, num, hardest)) {
+                if (board.cells[cell] != EMPTY || test.solution.cells[cell] != num) return false;
+                board.cells[cell] = num;
+            }
+            return true;
+        });
+        
+        check("candidates", kind, [&](const StressCase& test) {
+            for (int r = 0; r < SIZE; ++r) {
+                for (int c = 0; c < SIZE; ++c) {
+                    if (test.puzzle(r, c) != EMPTY) continue;
+                    DigitMask mask = 0;
+                    for (int num : game.getCandidates(test.puzzle, r, c)) mask |= digitBit(num);
+                    if (mask != scanCandidates(test.puzzle, r, c)) return false;
+                }
+            }
+            return true;
+        });
+        
+        // isCompleteSolution() one grid at a time, and verifySolutions() over
+        // the whole kind at once, against the plain scan: each puzzle, its
+        // reference solution, and that solution with two cells of a row
+        // swapped, which breaks columns but not the row
+        std::vector<Grid> checked;
+        for (size_t i = 0; i < kind.cases.size(); ++i) {
+            const StressCase& test = kind.cases[i];
+            checked.push_back(test.puzzle);
+            if (test.solutions == 0) continue;
+            checked.push_back(test.solution);
+            Grid swapped = test.solution;
+            int row = static_cast<int>(i % SIZE), col = static_cast<int>(i / SIZE % (SIZE - 1));
+            std::swap(swapped(row, col), swapped(row, col + 1));
+            checked.push_back(swapped);
+        }
+        StressResult single = {"verify/single/" + kind.name, checked.size(), 0, 0};
+        StressResult vector = {"verify/batch/" + kind.name, checked.size(), 0, 0};
+        std::unique_ptr<bool[]> each(new bool[checked.size()]);
+        std::unique_ptr<bool[]> verified(new bool[checked.size()]);
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < checked.size(); ++i) each[i] = isCompleteSolution(checked[i]);
+        single.totalNanos = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count();
+        start = std::chrono::steady_clock::now();
+        verifySolutions(checked.data(), checked.size(), verified.get());
+        vector.totalNanos = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count();
+        for (size_t i = 0; i < checked.size(); ++i) {
+            bool complete = scanSolution(checked[i]);
+            if (each[i] != complete) fail(single, checked[i]);
+            if (verified[i] != complete) fail(vector, checked[i]);
+        }
+        results.push_back(single);
+        results.push_back(vector);
+        
+        // tryRemove() against a fresh reference count: carve each solution
+        // in a random order, a clue or a rotational pair at a time, checking
+        // every verdict and the puzzle the checker is left holding. Only the
+        // tryRemove() calls are timed.
+        StressResult removal = {"remove/checker/" + kind.name, 0, 0, 0};
+        for (size_t i = 0; i < kind.cases.size(); ++i) {
+            const StressCase& test = kind.cases[i];
+            if (test.solutions == 0) continue;
+            int order[CELL_COUNT];
+            for (int c = 0; c < CELL_COUNT; ++c) order[c] = c;
+            std::mt19937 rng(static_cast<std::mt19937::result_type>(seed + i));
+            shuffleRange(order, order + CELL_COUNT, rng);
+            bool paired = i % 2 != 0;
+            
+            checker.reset(test.solution);
+            Grid carved = test.solution;
+            for (int c = 0; c < CELL_COUNT; ++c) {
+                int cells[2] = {order[c], CELL_COUNT - 1 - order[c]};
+                int size = paired && cells[1] != cells[0] ? 2 : 1;
+                if (carved.cells[cells[0]] == EMPTY) continue;
+                
+                start = std::chrono::steady_clock::now();
+                bool removed = checker.tryRemove(cells, size);
+                removal.totalNanos += std::chrono::duration<double, std::nano>(
+                    std::chrono::steady_clock::now() - start).count();
+                ++removal.operations;
+                
+                Grid cleared = carved;
+                for (int k = 0; k < size; ++k) cleared.cells[cells[k]] = EMPTY;
+                Grid work = cleared;
+                CandidateMasks masks;
+                masks.load(work);
+                bool unique = countReference(work, masks, 2, nullptr) == 1;
+                if (unique) carved = cleared;
+                if (removed != unique || checker.puzzle() != carved) {
+                    fail(removal, cleared);
+                    break;
+                }
+            }
+        }
+        if (removal.operations > 0) results.push_back(removal);
+    }
+    
+    size_t failures = 0;
+    for (const StressResult& r : results) failures += r.failures;
+    
+    if (json) {
+        std::printf("{\n  \"seed\": %llu,\n  \"count\": %lld,\n  \"failures\": %zu,\n  \"checks\": [\n",
+                    static_cast<unsigned long long>(seed), count, failures);
+        for (size_t i = 0; i < results.size(); ++i) {
+            const StressResult& r = results[i];
+            std::printf("    {\"name\": \"%s\", \"ops\": %zu, \"failures\": %zu, \"ns_per_op\": %.1f}%s\n",
+                        r.name.c_str(), r.operations, r.failures,
+                        r.operations == 0 ? 0.0 : r.totalNanos / r.operations,
+                        i + 1 < results.size() ? "," : "");
+        }
+        std::printf("  ]\n}\n");
+    } else {
+        std::printf("%-32s %8s %8s %12s\n", "check", "ops", "failed", "ns/op");
+        for (const StressResult& r : results) {
+            std::printf("%-32s %8zu %8zu %12.0f\n", r.name.c_str(), r.operations, r.failures,
+                        r.operations == 0 ? 0.0 : r.totalNanos / r.operations);
+        }
+    }
+    std::fflush(stdout);
+    std::fprintf(stderr, "%zu failures over %lld puzzles of each kind (seed %llu)\n",
+                 failures, count, static_cast<unsigned long long>(seed));
+    return failures == 0 ? 0 : 1;
+}
+
+bool parseDifficulty(const std::string& name, Difficulty& difficulty) {
+    if (name == "easy") difficulty = EASY;
+    else if (name == "medium") difficulty = MEDIUM;
+    else if (name == "hard") difficulty = HARD;
+    else if (name == "expert") difficulty = EXPERT;
+    else return false;
+    return true;
+}
+
+bool parseSymmetry(const std::string& name, Symmetry& symmetry) {
+    if (name == "none") symmetry = SYMMETRY_NONE;
+    else if (name == "rotational") symmetry = SYMMETRY_ROTATIONAL;
+    else if (name == "mirror") symmetry = SYMMETRY_MIRROR;
+    else return false;
+    return true;
+}
+
+void printUsage(const char* program) {
+    std::fprintf(stderr,
+                 "Usage: %s                     Play interactively\n"
+                 "       %s --solve [FILE]      Solve one-line puzzles or a binary corpus from FILE or stdin\n"
+                 "       %s --verify [FILE]     Check one-line full grids from FILE or stdin\n"
+                 "       %s --generate N        Generate N puzzles to stdout\n"
+                 "       %s --bench             Benchmark solver, hints and generator\n"
+                 "       %s --stress N          Cross-check every engine on N puzzles of each stress kind\n"
+                 "       %s --corpus FILE       Play with new games drawn from a binary corpus\n"
+                 "       %s --compact           Play with compact screens, for slow or shared terminals\n"
+                 "Options:\n"
+                 "  --engine backtrack|dlx|parallel  Solver back-end (default: backtrack)\n"
+                 "  --stats                     Append search counters to each solved line\n"
+                 "  --size 4|9|16|25            Board size for --solve, --verify and --generate (default: 9)\n"
+                 "  --difficulty LEVEL          easy, medium, hard, expert or all (default: medium)\n"
+                 "  --format text|binary        Output of --generate; binary writes a corpus (default: text)\n"
+                 "  --symmetry none|rotational|mirror  Clue pattern for --generate (default: none)\n"
+                 "  --rated                     Keep only puzzles whose technique rating matches --difficulty\n"
+                 "  --variants K                Write each generated puzzle and K-1 transformed copies of it\n"
+                 "  --dedup                     Drop generated duplicates up to symmetry; reuse solutions of repeats\n"
+                 "  --threads N                 Generator or parallel engine threads (default: all cores)\n"
+                 "  --seed S                    Base seed; puzzle i is keyed by S + i (default: random)\n"
+                 "  --warmup N, --repeat N      Benchmark passes (default: 1 warmup, 5 timed)\n"
+                 "  --json                      Benchmark or stress output as JSON\n",
+                 program, program, program, program, program, program, program, program);
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        if (argc == 1) {
+            PuzzlePool pool;
+            SudokuGame game;
+            game.setPool(&pool);
+            game.gameLoop();
+            return 0;
+        }
+        
+        bool solveMode = false;
+        bool verifyMode = false;
+        const char* inputPath = nullptr;
+        SolverEngine engine = BACKTRACKING;
+        long long generateCount = -1;
+        std::vector<Difficulty> levels(1, MEDIUM);
+        bool binary = false;
+        const char* corpusPath = nullptr;
+        Symmetry symmetry = SYMMETRY_NONE;
+        bool rated = false;
+        bool dedup = false;
+        int variants = 1;
+        int threads = 0;
+        bool seeded = false;
+        uint64_t seed = 0;
+        bool benchMode = false;
+        long long stressCount = -1;
+        bool json = false;
+        bool withStats = false;
+        bool compact = false;
+        int warmup = 1;
+        int repeat = 5;
+        int boardSize = SIZE;
+        
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--solve" || arg == "--verify") {
+                if (arg == "--solve") solveMode = true;
+                else verifyMode = true;
+                if (i + 1 < argc && (argv[i + 1][0] != '-' || argv[i + 1][1] == '\0')) {
+                    inputPath = argv[++i];
+                }
+            } else if (arg == "--engine" && i + 1 < argc) {
+                std::string name = argv[++i];
+                if (name == "dlx") {
+                    engine = DANCING_LINKS;
+                } else if (name == "backtrack") {
+                    engine = BACKTRACKING;
+                } else if (name == "parallel") {
+                    engine = PARALLEL;
+                } else {
+                    std::fprintf(stderr, "Unknown engine: %s\n", name.c_str());
+                    return 2;
+                }
+            } else if (arg == "--generate" && i + 1 < argc) {
+                generateCount = std::atoll(argv[++i]);
+                if (generateCount < 0) {
+                    std::fprintf(stderr, "Invalid puzzle count: %s\n", argv[i]);
+                    return 2;
+                }
+            } else if (arg == "--difficulty" && i + 1 < argc) {
+                std::string name = argv[++i];
+                if (name == "all") {
+                    static const Difficulty ALL[] = {EASY, MEDIUM, HARD, EXPERT};
+                    levels.assign(ALL, ALL + 4);
+                } else {
+                    Difficulty difficulty;
+                    if (!parseDifficulty(name, difficulty)) {
+                        std::fprintf(stderr, "Unknown difficulty: %s\n", name.c_str());
+                        return 2;
+                    }
+                    levels.assign(1, difficulty);
+                }
+            } else if (arg == "--format" && i + 1 < argc) {
+                std::string name = argv[++i];
+                if (name == "binary") {
+                    binary = true;
+                } else if (name == "text") {
+                    binary = false;
+                } else {
+                    std::fprintf(stderr, "Unknown format: %s\n", name.c_str());
+                    return 2;
+                }
+            } else if (arg == "--corpus" && i + 1 < argc) {
+                corpusPath = argv[++i];
+            } else if (arg == "--symmetry" && i + 1 < argc) {
+                if (!parseSymmetry(argv[++i], symmetry)) {
+                    std::fprintf(stderr, "Unknown symmetry: %s\n", argv[i]);
+                    return 2;
+                }
+            } else if (arg == "--size" && i + 1 < argc) {
+                boardSize = std::atoi(argv[++i]);
+                if (boardSize != 4 && boardSize != 9 && boardSize != 16 && boardSize != 25) {
+                    std::fprintf(stderr, "Unsupported board size: %s\n", argv[i]);
+                    return 2;
+                }
+            } else if (arg == "--threads" && i + 1 < argc) {
+                threads = std::atoi(argv[++i]);
+            } else if (arg == "--seed" && i + 1 < argc) {
+                seed = std::strtoull(argv[++i], nullptr, 0);
+                seeded = true;
+            } else if (arg == "--bench") {
+                benchMode = true;
+            } else if (arg == "--stress" && i + 1 < argc) {
+                stressCount = std::atoll(argv[++i]);
+                if (stressCount < 1) {
+                    std::fprintf(stderr, "Invalid puzzle count: %s\n", argv[i]);
+                    return 2;
+                }
+            } else if (arg == "--warmup" && i + 1 < argc) {
+                warmup = std::max(0, std::atoi(argv[++i]));
+            } else if (arg == "--repeat" && i + 1 < argc) {
+                repeat = std::max(1, std::atoi(argv[++i]));
+            } else if (arg == "--json") {
+                json = true;
+            } else if (arg == "--rated") {
+                rated = true;
+            } else if (arg == "--dedup") {
+                dedup = true;
+            } else if (arg == "--variants" && i + 1 < argc) {
+                variants = std::atoi(argv[++i]);
+                if (variants < 1) {
+                    std::fprintf(stderr, "Invalid variant count: %s\n", argv[i]);
+                    return 2;
+                }
+            } else if (arg == "--stats") {
+                withStats = true;
+            } else if (arg == "--compact") {
+                compact = true;
+            } else if (arg == "--help" || arg == "-h") {
+                printUsage(argv[0]);
+                return 0;
+            } else {
+                printUsage(argv[0]);
+                return 2;
+            }
+        }
+        
+        if (benchMode) {
+            return runBenchmarks(warmup, repeat, json);
+        }
+        
+        if (stressCount > 0) {
+            if (!seeded) {
+                std::random_device entropy;
+                seed = (static_cast<uint64_t>(entropy()) << 32) | entropy();
+            }
+            return runStress(stressCount, seed, threads, json);
+        }
+        
+        if (generateCount >= 0 && !solveMode && !verifyMode) {
+            if (!seeded) {
+                std::random_device entropy;
+                seed = (static_cast<uint64_t>(entropy()) << 32) | entropy();
+            }
+            switch (boardSize) {
+                case 4:
+                    return runBatchGenerate<2>(generateCount, levels, symmetry, rated, dedup, variants,
+                                               threads, seed, binary);
+                case 16:
+                    return runBatchGenerate<4>(generateCount, levels, symmetry, rated, dedup, variants,
+                                               threads, seed, binary);
+                case 25:
+                    return runBatchGenerate<5>(generateCount, levels, symmetry, rated, dedup, variants,
+                                               threads, seed, binary);
+                default:
+                    return runBatchGenerate<3>(generateCount, levels, symmetry, rated, dedup, variants,
+                                               threads, seed, binary);
+            }
+        }
+        
+        if ((corpusPath != nullptr || compact) && !solveMode && !verifyMode) {
+            MappedFile file;
+            CorpusView corpus;
+            if (corpusPath != nullptr &&
+                (!file.open(corpusPath) || !corpus.attach(file.data(), file.size()))) {
+                std::fprintf(stderr, "Cannot read 9x9 corpus %s\n", corpusPath);
+                return 1;
+            }
+            PuzzlePool pool;
+            SudokuGame game;
+            if (corpusPath != nullptr) game.setCorpus(&corpus);
+            game.setPool(&pool);
+            game.setCompact(compact);
+            game.gameLoop();
+            return 0;
+        }
+        
+        if (!solveMode && !verifyMode) {
+            printUsage(argv[0]);
+            return 2;
+        }
+        
+        std::ios::sync_with_stdio(false);
+        std::istream* in = &std::cin;
+        std::ifstream file;
+        if (inputPath != nullptr && std::strcmp(inputPath, "-") != 0) {
+            file.open(inputPath, std::ios::binary);
+            if (!file) {
+                std::fprintf(stderr, "Cannot open %s\n", inputPath);
+                return 1;
+            }
+            in = &file;
+            
+            // A binary corpus is solved from a mapping of the file instead
+            char magic[4];
+            if (solveMode && file.read(magic, sizeof(magic)) && std::memcmp(magic, "SDKC", 4) == 0) {
+                file.close();
+                MappedFile corpus;
+                if (!corpus.open(inputPath)) {
+                    std::fprintf(stderr, "Cannot open %s\n", inputPath);
+                    return 1;
+                }
+                switch (corpus.size() > 6 ? corpus.data()[6] : 0) {
+                    case 2: return runCorpusSolve<2>(corpus, engine, withStats, dedup, threads);
+                    case 3: return runCorpusSolve<3>(corpus, engine, withStats, dedup, threads);
+                    case 4: return runCorpusSolve<4>(corpus, engine, withStats, dedup, threads);
+                    case 5: return runCorpusSolve<5>(corpus, engine, withStats, dedup, threads);
+                    default:
+                        std::fprintf(stderr, "Malformed corpus %s\n", inputPath);
+                        return 1;
+                }
+            }
+            file.clear();
+            file.seekg(0);
+        }
+        if (verifyMode) {
+            switch (boardSize) {
+                case 4: return runBatchVerify<2>(*in);
+                case 16: return runBatchVerify<4>(*in);
+                case 25: return runBatchVerify<5>(*in);
+                default: return runBatchVerify<3>(*in);
+            }
+        }
+        switch (boardSize) {
+            case 4: return runTextSolve<2>(*in, engine, withStats, dedup, threads);
+            case 16: return runTextSolve<4>(*in, engine, withStats, dedup, threads);
+            case 25: return runTextSolve<5>(*in, engine, withStats, dedup, threads);
+            default: return runTextSolve<3>(*in, engine, withStats, dedup, threads);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << "\n";
+        return 1;
     }
-    
-    return 0;
 }
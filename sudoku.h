@@ -0,0 +1,3393 @@
+// Sudoku solver and generator library: grids, candidate masks, the
+// backtracking, uniqueness and Dancing Links search engines, and the puzzle
+// generator. Header-only, with no console I/O and no exceptions, so it can
+// be embedded directly in other programs.
+//
+// Everything is a template on the box dimension BOX (2, 3, 4 or 5 for 4x4,
+// 9x9, 16x16 and 25x25 boards), so each size gets its own code with the mask
+// width and loop bounds fixed at compile time. The familiar names (Grid,
+// Solver, Generator, ...) are the 9x9 instantiations, declared at the end.
+#ifndef SUDOKU_H
+#define SUDOKU_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace sudoku {
+
+constexpr int EMPTY = 0;
+
+// Board geometry for boxes of BOX x BOX cells
+template <int BOX>
+struct Dimensions {
+    static_assert(BOX >= 2 && BOX <= 5, "Supported boards are 4x4 through 25x25");
+
+    static const int BOX_SIZE = BOX;
+    static const int SIZE = BOX * BOX;          // Digits, and cells per unit
+    static const int CELL_COUNT = SIZE * SIZE;
+    static const int UNIT_COUNT = 3 * SIZE;     // Rows, then columns, then boxes
+
+    // Digit sets: bit (n - 1) is set when digit n is in the set, in the
+    // narrowest type that holds SIZE bits
+    typedef typename std::conditional<(SIZE <= 16), uint16_t, uint32_t>::type Mask;
+    static const Mask ALL_DIGITS = static_cast<Mask>((1u << SIZE) - 1);
+};
+
+template <int BOX> const int Dimensions<BOX>::BOX_SIZE;
+template <int BOX> const int Dimensions<BOX>::SIZE;
+template <int BOX> const int Dimensions<BOX>::CELL_COUNT;
+template <int BOX> const int Dimensions<BOX>::UNIT_COUNT;
+template <int BOX> const typename Dimensions<BOX>::Mask Dimensions<BOX>::ALL_DIGITS;
+
+inline uint32_t digitBit(int num) {
+    return 1u << (num - 1);
+}
+
+inline int countDigits(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount(mask);
+#else
+    int count = 0;
+    for (; mask; mask &= mask - 1) ++count;
+    return count;
+#endif
+}
+
+// Smallest digit in a non-empty mask
+inline int lowestDigit(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask) + 1;
+#else
+    int num = 1;
+    for (; !(mask & 1u); mask >>= 1) ++num;
+    return num;
+#endif
+}
+
+// Cell symbols in the line format: '1'-'9', then 'A'-'P' for 10-25
+inline char digitSymbol(int num) {
+    return static_cast<char>(num < 10 ? '0' + num : 'A' + num - 10);
+}
+
+// Digit value of a symbol (letters in either case), or 0 if it is not one
+inline int symbolDigit(char ch) {
+    if (ch >= '1' && ch <= '9') return ch - '0';
+    if (ch >= 'A' && ch <= 'Z') return ch - 'A' + 10;
+    if (ch >= 'a' && ch <= 'z') return ch - 'a' + 10;
+    return 0;
+}
+
+// Flat row-major grid, one byte per cell: contiguous and trivially copyable,
+// so copying a grid is a memcpy rather than a heap allocation per row
+template <int BOX>
+struct BasicGrid {
+    typedef Dimensions<BOX> Dim;
+
+    std::array<uint8_t, Dim::CELL_COUNT> cells;
+
+    BasicGrid() { cells.fill(EMPTY); }
+
+    static int index(int row, int col) { return row * Dim::SIZE + col; }
+
+    uint8_t& operator()(int row, int col) { return cells[index(row, col)]; }
+    uint8_t operator()(int row, int col) const { return cells[index(row, col)]; }
+
+    void clear() { cells.fill(EMPTY); }
+
+    bool operator==(const BasicGrid& other) const { return cells == other.cells; }
+    bool operator!=(const BasicGrid& other) const { return cells != other.cells; }
+};
+
+// Parse the one-line format: CELL_COUNT cells, each a digit symbol (see
+// digitSymbol()) or '0' or '.' for empty, optionally followed by whitespace
+// and anything else
+template <int BOX>
+bool parseGrid(const char* text, size_t length, BasicGrid<BOX>& grid) {
+    const int CELL_COUNT = Dimensions<BOX>::CELL_COUNT;
+    if (length < static_cast<size_t>(CELL_COUNT)) return false;
+    if (length > static_cast<size_t>(CELL_COUNT) &&
+        !std::isspace(static_cast<unsigned char>(text[CELL_COUNT]))) return false;
+    
+    for (int i = 0; i < CELL_COUNT; ++i) {
+        char ch = text[i];
+        int num = symbolDigit(ch);
+        if (num != 0 && num <= Dimensions<BOX>::SIZE) {
+            grid.cells[i] = num;
+        } else if (ch == '0' || ch == '.') {
+            grid.cells[i] = EMPTY;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Write the CELL_COUNT-character line form of grid (no terminator), '.' for empty
+template <int BOX>
+void formatGrid(const BasicGrid<BOX>& grid, char* out) {
+    for (int i = 0; i < Dimensions<BOX>::CELL_COUNT; ++i) {
+        out[i] = grid.cells[i] == EMPTY ? '.' : digitSymbol(grid.cells[i]);
+    }
+}
+
+// Per-row, per-column and per-box occupancy masks, kept in step with a grid
+// by place()/unplace() so a candidate set is a single OR/NOT instead of a scan
+template <int BOX>
+class BasicCandidateMasks {
+public:
+    typedef Dimensions<BOX> Dim;
+    typedef typename Dim::Mask Mask;
+
+    BasicCandidateMasks() { clear(); }
+
+    void clear() {
+        for (int i = 0; i < Dim::SIZE; ++i) {
+            rows[i] = cols[i] = boxes[i] = 0;
+        }
+    }
+
+    // Rebuild from a grid; returns false if the filled cells already conflict
+    bool load(const BasicGrid<BOX>& grid) {
+        clear();
+        for (int r = 0; r < Dim::SIZE; ++r) {
+            for (int c = 0; c < Dim::SIZE; ++c) {
+                int num = grid(r, c);
+                if (num == EMPTY) continue;
+                if (!canPlace(r, c, num)) return false;
+                place(r, c, num);
+            }
+        }
+        return true;
+    }
+
+    static int boxIndex(int row, int col) {
+        return (row / BOX) * BOX + col / BOX;
+    }
+
+    Mask candidates(int row, int col) const {
+        return Dim::ALL_DIGITS & ~(rows[row] | cols[col] | boxes[boxIndex(row, col)]);
+    }
+
+    bool canPlace(int row, int col, int num) const {
+        return (candidates(row, col) & digitBit(num)) != 0;
+    }
+
+    void place(int row, int col, int num) {
+        Mask bit = digitBit(num);
+        rows[row] |= bit;
+        cols[col] |= bit;
+        boxes[boxIndex(row, col)] |= bit;
+    }
+
+    Mask rowDigits(int row) const { return rows[row]; }
+    Mask colDigits(int col) const { return cols[col]; }
+    Mask boxDigits(int box) const { return boxes[box]; }
+
+    void unplace(int row, int col, int num) {
+        Mask bit = ~digitBit(num);
+        rows[row] &= bit;
+        cols[col] &= bit;
+        boxes[boxIndex(row, col)] &= bit;
+    }
+
+private:
+    Mask rows[Dim::SIZE];
+    Mask cols[Dim::SIZE];
+    Mask boxes[Dim::SIZE];
+};
+
+// Outcome of validating a player move. Ordinary bad input is reported
+// through this code rather than an exception.
+enum MoveResult {
+    MOVE_OK,
+    MOVE_OUT_OF_BOUNDS,
+    MOVE_FIXED_CELL,
+    MOVE_INVALID_VALUE,
+    MOVE_ROW_CONFLICT,      // Digit already in the row
+    MOVE_COLUMN_CONFLICT,   // Digit already in the column
+    MOVE_BOX_CONFLICT       // Digit already in the box
+};
+
+inline const char* moveResultMessage(MoveResult result) {
+    switch (result) {
+        case MOVE_OK: return "OK";
+        case MOVE_OUT_OF_BOUNDS: return "Position out of bounds";
+        case MOVE_FIXED_CELL: return "Cannot modify fixed cell";
+        case MOVE_INVALID_VALUE: return "Invalid value";
+        case MOVE_ROW_CONFLICT: return "Invalid move - number already in this row";
+        case MOVE_COLUMN_CONFLICT: return "Invalid move - number already in this column";
+        case MOVE_BOX_CONFLICT: return "Invalid move - number already in this box";
+    }
+    return "Unknown error";
+}
+
+// Which unit already holds num, in O(1). The cell itself must not hold num.
+template <int BOX>
+MoveResult checkPlacement(const BasicCandidateMasks<BOX>& masks, int row, int col, int num) {
+    uint32_t bit = digitBit(num);
+    if (masks.rowDigits(row) & bit) return MOVE_ROW_CONFLICT;
+    if (masks.colDigits(col) & bit) return MOVE_COLUMN_CONFLICT;
+    if (masks.boxDigits(BasicCandidateMasks<BOX>::boxIndex(row, col)) & bit) return MOVE_BOX_CONFLICT;
+    return MOVE_OK;
+}
+
+// True if grid is a complete solution: every cell filled and every row,
+// column and box holding each digit exactly once. A unit of SIZE cells whose
+// digit bits OR to ALL_DIGITS holds every digit once, so one pass over the
+// cells settles it without a second scan for duplicates.
+template <int BOX>
+bool isCompleteSolution(const BasicGrid<BOX>& grid) {
+    typedef Dimensions<BOX> Dim;
+    typename Dim::Mask rows[Dim::SIZE] = {}, cols[Dim::SIZE] = {}, boxes[Dim::SIZE] = {};
+    for (int r = 0; r < Dim::SIZE; ++r) {
+        for (int c = 0; c < Dim::SIZE; ++c) {
+            int num = grid(r, c);
+            if (num == EMPTY || num > Dim::SIZE) return false;
+            uint32_t bit = digitBit(num);
+            rows[r] |= bit;
+            cols[c] |= bit;
+            boxes[BasicCandidateMasks<BOX>::boxIndex(r, c)] |= bit;
+        }
+    }
+    typename Dim::Mask all = Dim::ALL_DIGITS;
+    for (int i = 0; i < Dim::SIZE; ++i) {
+        all &= rows[i] & cols[i] & boxes[i];
+    }
+    return all == Dim::ALL_DIGITS;
+}
+
+#if defined(__SSSE3__) || (defined(__ARM_NEON) && defined(__aarch64__))
+#define SUDOKU_SIMD_VERIFY 1
+#endif
+
+#ifdef SUDOKU_SIMD_VERIFY
+// Vector kernels for 9x9 verification. Each row is one 16-byte vector (only
+// lanes 0-8 count); a byte table lookup turns its digits into bits, split
+// over two vectors since nine bits do not fit a byte: digits 1-8 in one,
+// digit 9 in the other. OR-ing the row vectors checks all nine columns at
+// once; byte shifts fold lanes together for the boxes and rows.
+namespace simd {
+
+static const uint8_t LOW_DIGIT_BITS[16] = {0, 1, 2, 4, 8, 16, 32, 64, 128, 0, 0, 0, 0, 0, 0, 0};
+static const uint8_t HIGH_DIGIT_BITS[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0};
+
+// Lanes each check ignores (0xFF): only lane 0 holds a whole row, lanes
+// 0, 3 and 6 hold the band's three boxes, and lanes 0-8 the columns
+static const uint8_t ROW_IGNORED[16] = {
+    0, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255};
+static const uint8_t BOX_IGNORED[16] = {
+    0, 255, 255, 0, 255, 255, 0, 255, 255, 255, 255, 255, 255, 255, 255, 255};
+static const uint8_t COLUMN_IGNORED[16] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 255, 255, 255, 255, 255, 255, 255};
+
+#if defined(__SSSE3__)
+struct Sse {
+    typedef __m128i Vec;
+    static const int GRIDS = 1;
+
+    static Vec load(const BasicGrid<3>* grids, int offset) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(grids[0].cells.data() + offset));
+    }
+    static Vec constant(const uint8_t* bytes) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+    }
+    static Vec broadcast(uint8_t value) { return _mm_set1_epi8(static_cast<char>(value)); }
+    static Vec lookup(Vec table, Vec index) { return _mm_shuffle_epi8(table, index); }
+    static Vec bitOr(Vec a, Vec b) { return _mm_or_si128(a, b); }
+    static Vec bitAnd(Vec a, Vec b) { return _mm_and_si128(a, b); }
+    static Vec maxU8(Vec a, Vec b) { return _mm_max_epu8(a, b); }
+    static Vec equal(Vec a, Vec b) { return _mm_cmpeq_epi8(a, b); }
+    template <int BYTES> static Vec shiftDown(Vec a) { return _mm_srli_si128(a, BYTES); }
+    static uint32_t laneBits(Vec a) { return static_cast<uint32_t>(_mm_movemask_epi8(a)); }
+};
+#endif
+
+#if defined(__AVX2__)
+// Two grids per pass, one per 128-bit half. The shuffles and byte shifts
+// work within each half, so the kernel is the same as for one grid.
+struct Avx2 {
+    typedef __m256i Vec;
+    static const int GRIDS = 2;
+
+    static Vec load(const BasicGrid<3>* grids, int offset) {
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(grids[0].cells.data() + offset));
+        __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(grids[1].cells.data() + offset));
+        return _mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1);
+    }
+    static Vec constant(const uint8_t* bytes) {
+        return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes)));
+    }
+    static Vec broadcast(uint8_t value) { return _mm256_set1_epi8(static_cast<char>(value)); }
+    static Vec lookup(Vec table, Vec index) { return _mm256_shuffle_epi8(table, index); }
+    static Vec bitOr(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+    static Vec bitAnd(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+    static Vec maxU8(Vec a, Vec b) { return _mm256_max_epu8(a, b); }
+    static Vec equal(Vec a, Vec b) { return _mm256_cmpeq_epi8(a, b); }
+    template <int BYTES> static Vec shiftDown(Vec a) { return _mm256_srli_si256(a, BYTES); }
+    static uint32_t laneBits(Vec a) { return static_cast<uint32_t>(_mm256_movemask_epi8(a)); }
+};
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+struct Neon {
+    typedef uint8x16_t Vec;
+    static const int GRIDS = 1;
+
+    static Vec load(const BasicGrid<3>* grids, int offset) { return vld1q_u8(grids[0].cells.data() + offset); }
+    static Vec constant(const uint8_t* bytes) { return vld1q_u8(bytes); }
+    static Vec broadcast(uint8_t value) { return vdupq_n_u8(value); }
+    static Vec lookup(Vec table, Vec index) { return vqtbl1q_u8(table, index); }
+    static Vec bitOr(Vec a, Vec b) { return vorrq_u8(a, b); }
+    static Vec bitAnd(Vec a, Vec b) { return vandq_u8(a, b); }
+    static Vec maxU8(Vec a, Vec b) { return vmaxq_u8(a, b); }
+    static Vec equal(Vec a, Vec b) { return vceqq_u8(a, b); }
+    template <int BYTES> static Vec shiftDown(Vec a) { return vextq_u8(a, vdupq_n_u8(0), BYTES); }
+
+    // NEON has no movemask: weight each lane by its bit and add up each half
+    static uint32_t laneBits(Vec a) {
+        static const uint8_t WEIGHTS[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+        uint8x16_t weighted = vandq_u8(a, vld1q_u8(WEIGHTS));
+        return vaddv_u8(vget_low_u8(weighted)) | (static_cast<uint32_t>(vaddv_u8(vget_high_u8(weighted))) << 8);
+    }
+};
+#endif
+
+// Row r of each grid in lanes 0-8. The last row is loaded from the end of
+// the grid and shifted down, so no load reads past the 81 cells.
+template <typename Ops>
+typename Ops::Vec loadRow(const BasicGrid<3>* grids, int row) {
+    if (row < 8) return Ops::load(grids, row * 9);
+    return Ops::template shiftDown<7>(Ops::load(grids, 65));
+}
+
+// OR of lanes i, i+1 and i+2 into lane i
+template <typename Ops>
+typename Ops::Vec foldThree(typename Ops::Vec a) {
+    return Ops::bitOr(a, Ops::bitOr(Ops::template shiftDown<1>(a), Ops::template shiftDown<2>(a)));
+}
+
+// Lanes where the digit bits cover all nine digits
+template <typename Ops>
+typename Ops::Vec allDigits(typename Ops::Vec low, typename Ops::Vec high) {
+    return Ops::bitAnd(Ops::equal(low, Ops::broadcast(0xFF)), Ops::equal(high, Ops::broadcast(1)));
+}
+
+// Bit g of the result is set if grids[g] is a complete solution
+template <typename Ops>
+uint32_t verify(const BasicGrid<3>* grids) {
+    typedef typename Ops::Vec Vec;
+    const Vec lowTable = Ops::constant(LOW_DIGIT_BITS);
+    const Vec highTable = Ops::constant(HIGH_DIGIT_BITS);
+    const Vec nine = Ops::broadcast(9);
+    const Vec zero = Ops::broadcast(0);
+
+    Vec ok = Ops::broadcast(0xFF);
+    Vec rowsOk = ok;
+    Vec columnLow = zero, columnHigh = zero;
+    Vec bandLow = zero, bandHigh = zero;
+
+    for (int r = 0; r < 9; ++r) {
+        Vec cells = loadRow<Ops>(grids, r);
+        // Cell values above 9 would alias table entries
+        ok = Ops::bitAnd(ok, Ops::equal(Ops::maxU8(cells, nine), nine));
+
+        Vec low = Ops::lookup(lowTable, cells);
+        Vec high = Ops::lookup(highTable, cells);
+        columnLow = Ops::bitOr(columnLow, low);
+        columnHigh = Ops::bitOr(columnHigh, high);
+        bandLow = Ops::bitOr(bandLow, low);
+        bandHigh = Ops::bitOr(bandHigh, high);
+
+        // Lanes 9-15 hold the next row's cells; the shifts fold in lanes 0-8 only
+        Vec tripleLow = foldThree<Ops>(low);
+        Vec tripleHigh = foldThree<Ops>(high);
+        Vec rowLow = Ops::bitOr(tripleLow, Ops::bitOr(Ops::template shiftDown<3>(tripleLow),
+                                                      Ops::template shiftDown<6>(tripleLow)));
+        Vec rowHigh = Ops::bitOr(tripleHigh, Ops::bitOr(Ops::template shiftDown<3>(tripleHigh),
+                                                        Ops::template shiftDown<6>(tripleHigh)));
+        rowsOk = Ops::bitAnd(rowsOk, allDigits<Ops>(rowLow, rowHigh));
+
+        if (r % 3 == 2) {
+            Vec boxes = allDigits<Ops>(foldThree<Ops>(bandLow), foldThree<Ops>(bandHigh));
+            ok = Ops::bitAnd(ok, Ops::bitOr(boxes, Ops::constant(BOX_IGNORED)));
+            bandLow = bandHigh = zero;
+        }
+    }
+
+    ok = Ops::bitAnd(ok, Ops::bitOr(rowsOk, Ops::constant(ROW_IGNORED)));
+    ok = Ops::bitAnd(ok, Ops::bitOr(allDigits<Ops>(columnLow, columnHigh), Ops::constant(COLUMN_IGNORED)));
+
+    uint32_t lanes = Ops::laneBits(ok);
+    uint32_t valid = 0;
+    for (int g = 0; g < Ops::GRIDS; ++g) {
+        if (((lanes >> (16 * g)) & 0xFFFF) == 0xFFFF) valid |= 1u << g;
+    }
+    return valid;
+}
+
+#if defined(__SSSE3__)
+typedef Sse SingleGrid;
+#else
+typedef Neon SingleGrid;
+#endif
+
+} // namespace simd
+#endif // SUDOKU_SIMD_VERIFY
+
+// Verify count grids, setting valid[i] for each; returns how many are
+// complete solutions. 9x9 grids go through the vector kernels when the
+// target has them (SSSE3, AVX2 or AArch64 NEON), two grids a pass on AVX2.
+template <int BOX>
+size_t verifySolutions(const BasicGrid<BOX>* grids, size_t count, bool* valid) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        valid[i] = isCompleteSolution(grids[i]);
+        total += valid[i];
+    }
+    return total;
+}
+
+#ifdef SUDOKU_SIMD_VERIFY
+template <>
+inline bool isCompleteSolution<3>(const BasicGrid<3>& grid) {
+    return simd::verify<simd::SingleGrid>(&grid) != 0;
+}
+
+template <>
+inline size_t verifySolutions<3>(const BasicGrid<3>* grids, size_t count, bool* valid) {
+    size_t total = 0;
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 2 <= count; i += 2) {
+        uint32_t pair = simd::verify<simd::Avx2>(grids + i);
+        valid[i] = (pair & 1u) != 0;
+        valid[i + 1] = (pair & 2u) != 0;
+        total += valid[i] + valid[i + 1];
+    }
+#endif
+    for (; i < count; ++i) {
+        valid[i] = simd::verify<simd::SingleGrid>(grids + i) != 0;
+        total += valid[i];
+    }
+    return total;
+}
+#endif
+
+// Uniform integer in [0, bound) from raw engine output. The algorithms behind
+// std::uniform_int_distribution and std::shuffle are up to the standard
+// library; this one is fixed, so a seed yields the same puzzle everywhere.
+inline uint32_t randomBelow(std::mt19937& rng, uint32_t bound) {
+    uint32_t threshold = (0u - bound) % bound;
+    uint32_t value;
+    do {
+        value = static_cast<uint32_t>(rng());
+    } while (value < threshold);
+    return value % bound;
+}
+
+// Fisher-Yates shuffle on top of randomBelow()
+template <typename Iterator>
+void shuffleRange(Iterator first, Iterator last, std::mt19937& rng) {
+    for (uint32_t n = static_cast<uint32_t>(last - first); n > 1; --n) {
+        std::swap(first[n - 1], first[randomBelow(rng, n)]);
+    }
+}
+
+// Find cell with minimum candidates (MRV heuristic); returns false when the
+// grid is full. A dead end shows up as a cell with no candidates.
+template <int BOX>
+bool findBestCell(const BasicGrid<BOX>& grid, const BasicCandidateMasks<BOX>& masks,
+                  int& row, int& col, typename Dimensions<BOX>::Mask& candidates) {
+    typedef Dimensions<BOX> Dim;
+    int minCandidates = Dim::SIZE + 1;
+    bool found = false;
+
+    for (int r = 0; r < Dim::SIZE; ++r) {
+        for (int c = 0; c < Dim::SIZE; ++c) {
+            if (grid(r, c) == EMPTY) {
+                typename Dim::Mask cellCandidates = masks.candidates(r, c);
+                int candidateCount = countDigits(cellCandidates);
+                if (candidateCount < minCandidates) {
+                    minCandidates = candidateCount;
+                    row = r;
+                    col = c;
+                    candidates = cellCandidates;
+                    found = true;
+                    if (candidateCount <= 1) return found; // Forced or dead end
+                }
+            }
+        }
+    }
+    return found;
+}
+
+// The 3 * SIZE units (rows, columns, boxes) as lists of cell indices
+template <int BOX>
+struct BasicUnitTable {
+    typedef Dimensions<BOX> Dim;
+
+    uint16_t cells[Dim::UNIT_COUNT][Dim::SIZE];
+
+    BasicUnitTable() {
+        for (int i = 0; i < Dim::SIZE; ++i) {
+            for (int k = 0; k < Dim::SIZE; ++k) {
+                cells[i][k] = BasicGrid<BOX>::index(i, k);
+                cells[Dim::SIZE + i][k] = BasicGrid<BOX>::index(k, i);
+                cells[2 * Dim::SIZE + i][k] = BasicGrid<BOX>::index((i / BOX) * BOX + k / BOX,
+                                                                    (i % BOX) * BOX + k % BOX);
+            }
+        }
+    }
+
+    static const BasicUnitTable& instance() {
+        static const BasicUnitTable table;
+        return table;
+    }
+};
+
+// Cells filled during a search, in order, so the search can roll back to a mark
+template <int BOX>
+struct BasicPlacementTrail {
+    int cells[Dimensions<BOX>::CELL_COUNT];
+    int size;
+
+    BasicPlacementTrail() : size(0) {}
+};
+
+template <int BOX>
+void placeOnTrail(BasicGrid<BOX>& grid, BasicCandidateMasks<BOX>& masks,
+                  BasicPlacementTrail<BOX>& trail, int cell, int num) {
+    grid.cells[cell] = num;
+    masks.place(cell / Dimensions<BOX>::SIZE, cell % Dimensions<BOX>::SIZE, num);
+    trail.cells[trail.size++] = cell;
+}
+
+template <int BOX>
+void undoTrail(BasicGrid<BOX>& grid, BasicCandidateMasks<BOX>& masks,
+               BasicPlacementTrail<BOX>& trail, int mark) {
+    while (trail.size > mark) {
+        int cell = trail.cells[--trail.size];
+        masks.unplace(cell / Dimensions<BOX>::SIZE, cell % Dimensions<BOX>::SIZE, grid.cells[cell]);
+        grid.cells[cell] = EMPTY;
+    }
+}
+
+// Apply naked and hidden singles until neither finds anything. Placements go
+// on the trail; returns false on a contradiction, i.e. a cell with no
+// candidates or a digit with no place left in some unit.
+template <int BOX>
+bool propagateSingles(BasicGrid<BOX>& grid, BasicCandidateMasks<BOX>& masks,
+                      BasicPlacementTrail<BOX>& trail) {
+    typedef Dimensions<BOX> Dim;
+    typedef typename Dim::Mask Mask;
+    const BasicUnitTable<BOX>& units = BasicUnitTable<BOX>::instance();
+    bool progress = true;
+    
+    while (progress) {
+        progress = false;
+        
+        // Naked singles
+        for (int i = 0; i < Dim::CELL_COUNT; ++i) {
+            if (grid.cells[i] != EMPTY) continue;
+            Mask candidates = masks.candidates(i / Dim::SIZE, i % Dim::SIZE);
+            if (candidates == 0) return false;
+            if ((candidates & (candidates - 1)) == 0) {
+                placeOnTrail(grid, masks, trail, i, lowestDigit(candidates));
+                progress = true;
+            }
+        }
+        
+        // Hidden singles: digits allowed in exactly one empty cell of a unit
+        for (int u = 0; u < Dim::UNIT_COUNT; ++u) {
+            Mask once = 0, twice = 0, filled = 0;
+            for (int k = 0; k < Dim::SIZE; ++k) {
+                int cell = units.cells[u][k];
+                if (grid.cells[cell] != EMPTY) {
+                    filled |= digitBit(grid.cells[cell]);
+                } else {
+                    Mask candidates = masks.candidates(cell / Dim::SIZE, cell % Dim::SIZE);
+                    twice |= once & candidates;
+                    once |= candidates;
+                }
+            }
+            if ((once | filled) != Dim::ALL_DIGITS) return false;
+
+            for (Mask hidden = once & ~twice & ~filled; hidden; hidden &= hidden - 1) {
+                int num = lowestDigit(hidden);
+                bool placed = false;
+                for (int k = 0; k < Dim::SIZE && !placed; ++k) {
+                    int cell = units.cells[u][k];
+                    if (grid.cells[cell] == EMPTY &&
+                        masks.canPlace(cell / Dim::SIZE, cell % Dim::SIZE, num)) {
+                        placeOnTrail(grid, masks, trail, cell, num);
+                        placed = true;
+                    }
+                }
+                // Its only cell was taken by another single in this unit
+                if (!placed) return false;
+                progress = true;
+            }
+        }
+    }
+    return true;
+}
+
+// Counters a search fills in when the caller passes a SearchStats. Counts
+// accumulate, so one struct can total several calls.
+struct SearchStats {
+    uint64_t nodes;           // Guesses tried
+    uint64_t backtracks;      // Guesses retracted after their subtree failed
+    uint64_t propagations;    // Cells filled by singles propagation
+    int maxDepth;             // Deepest stack of simultaneous guesses
+    uint64_t selectNanos;     // Time choosing where to branch (findBestCell)
+    uint64_t propagateNanos;  // Time generating candidates and propagating singles
+
+    SearchStats() : nodes(0), backtracks(0), propagations(0), maxDepth(0),
+                    selectNanos(0), propagateNanos(0) {}
+};
+
+// Searches are templates on a recorder. StatsRecorder fills a SearchStats;
+// NullRecorder has empty inline members, so without stats the instrumented
+// code compiles away entirely, timer reads included.
+class StatsRecorder {
+public:
+    explicit StatsRecorder(SearchStats& target) : stats(target) {}
+
+    void node(int depth) {
+        ++stats.nodes;
+        if (depth > stats.maxDepth) stats.maxDepth = depth;
+    }
+    void backtrack() { ++stats.backtracks; }
+    void propagated(int placements) { stats.propagations += placements; }
+
+    uint64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    void selectTime(uint64_t start) { stats.selectNanos += now() - start; }
+    void propagateTime(uint64_t start) { stats.propagateNanos += now() - start; }
+
+private:
+    SearchStats& stats;
+};
+
+struct NullRecorder {
+    void node(int) {}
+    void backtrack() {}
+    void propagated(int) {}
+    uint64_t now() const { return 0; }
+    void selectTime(uint64_t) {}
+    void propagateTime(uint64_t) {}
+};
+
+// findBestCell() and propagateSingles() with their cost reported to recorder
+template <int BOX, typename Recorder>
+bool findBestCell(const BasicGrid<BOX>& grid, const BasicCandidateMasks<BOX>& masks,
+                  int& row, int& col, typename Dimensions<BOX>::Mask& candidates,
+                  Recorder& recorder) {
+    uint64_t start = recorder.now();
+    bool found = findBestCell(grid, masks, row, col, candidates);
+    recorder.selectTime(start);
+    return found;
+}
+
+template <int BOX, typename Recorder>
+bool propagateSingles(BasicGrid<BOX>& grid, BasicCandidateMasks<BOX>& masks,
+                      BasicPlacementTrail<BOX>& trail, Recorder& recorder) {
+    uint64_t start = recorder.now();
+    int before = trail.size;
+    bool consistent = propagateSingles(grid, masks, trail);
+    recorder.propagated(trail.size - before);
+    recorder.propagateTime(start);
+    return consistent;
+}
+
+// Solution counter that never allocates: the search runs on a fixed-depth
+// explicit stack and stops as soon as the requested number of solutions is seen.
+//
+// It also carves puzzles incrementally. After reset() with a full solution,
+// each tryRemove() clears one clue and only has to look for a solution that
+// differs from the known one in that cell, with the masks kept in step
+// instead of being rebuilt for every removal. A removal can be given a node
+// budget; if that search runs out the clue is kept, since uniqueness was not
+// proven.
+template <int BOX>
+class BasicUniquenessChecker {
+public:
+    typedef BasicGrid<BOX> Grid;
+    typedef BasicCandidateMasks<BOX> CandidateMasks;
+    typedef typename Dimensions<BOX>::Mask Mask;
+
+    // Count solutions of grid, stopping once limit is reached
+    int countSolutions(const Grid& grid, int limit, SearchStats* stats = nullptr) {
+        if (stats) {
+            StatsRecorder recorder(*stats);
+            return countSolutions(grid, limit, recorder);
+        }
+        NullRecorder recorder;
+        return countSolutions(grid, limit, recorder);
+    }
+
+    // Start carving from a complete, valid solution
+    void reset(const Grid& solved) {
+        current = solved;
+        masks.load(current);
+    }
+
+    // Clear a clue if the puzzle stays uniquely solvable; otherwise put it
+    // back. nodeBudget caps the guesses spent proving it (0 for no cap).
+    bool tryRemove(int row, int col, uint64_t nodeBudget = 0) {
+        int cell = Grid::index(row, col);
+        return tryRemove(&cell, 1, nodeBudget);
+    }
+    
+    // Clear up to MAX_GROUP clues together (a symmetric pair, say), keeping
+    // the removal only if the puzzle stays uniquely solvable. Any other
+    // solution differs in one of the cells; the first cell it differs in is
+    // checked with the cells before it fixed to their known values.
+    bool tryRemove(const int* cells, int count, uint64_t nodeBudget = 0) {
+        int values[MAX_GROUP];
+        for (int i = 0; i < count; ++i) {
+            values[i] = current.cells[cells[i]];
+            if (values[i] != EMPTY) clearCell(cells[i], values[i]);
+        }
+        
+        bool unique = true;
+        for (int i = 0; i < count && unique; ++i) {
+            if (values[i] == EMPTY) continue;
+            unique = isForced(cells[i], values[i]) || !hasAlternative(cells[i], values[i], nodeBudget);
+            fillCell(cells[i], values[i]);
+        }
+        
+        for (int i = 0; i < count; ++i) {
+            if (values[i] == EMPTY) continue;
+            if (unique && current.cells[cells[i]] != EMPTY) {
+                clearCell(cells[i], values[i]);
+            } else if (!unique && current.cells[cells[i]] == EMPTY) {
+                fillCell(cells[i], values[i]);
+            }
+        }
+        return unique;
+    }
+    
+    static const int MAX_GROUP = 4;
+
+    const Grid& puzzle() const { return current; }
+
+private:
+    typedef Dimensions<BOX> Dim;
+
+    struct Frame {
+        int row, col;
+        Mask remaining;
+        int trailMark;   // Trail size before this frame's guess
+    };
+
+    void clearCell(int cell, int num) {
+        current.cells[cell] = EMPTY;
+        masks.unplace(cell / Dim::SIZE, cell % Dim::SIZE, num);
+    }
+
+    void fillCell(int cell, int num) {
+        current.cells[cell] = num;
+        masks.place(cell / Dim::SIZE, cell % Dim::SIZE, num);
+    }
+
+    // num is a hidden single at the empty cell: some unit of the cell has
+    // no other empty cell that can take it, so every solution puts it here
+    bool isForced(int cell, int num) const {
+        const BasicUnitTable<BOX>& units = BasicUnitTable<BOX>::instance();
+        int row = cell / Dim::SIZE, col = cell % Dim::SIZE;
+        int unitOf[3] = {row, Dim::SIZE + col,
+                         2 * Dim::SIZE + BasicCandidateMasks<BOX>::boxIndex(row, col)};
+        for (int u = 0; u < 3; ++u) {
+            bool elsewhere = false;
+            for (int k = 0; k < Dim::SIZE && !elsewhere; ++k) {
+                int other = units.cells[unitOf[u]][k];
+                elsewhere = other != cell && current.cells[other] == EMPTY &&
+                            masks.canPlace(other / Dim::SIZE, other % Dim::SIZE, num);
+            }
+            if (!elsewhere) return true;
+        }
+        return false;
+    }
+
+    // Whether the empty cell can hold something other than num in some
+    // solution. A search that runs out of budget counts as yes.
+    bool hasAlternative(int cell, int num, uint64_t nodeBudget) {
+        int row = cell / Dim::SIZE, col = cell % Dim::SIZE;
+        // The known solution still fits, so any other one must differ here
+        Mask alternatives = masks.candidates(row, col) & ~digitBit(num);
+        if (alternatives == 0) return false;
+        
+        trail.size = 0;
+        budget = nodeBudget;
+        return search(current, masks, row, col, alternatives, 1, noStats) != 0 || budget == OVER_BUDGET;
+    }
+
+    template <typename Recorder>
+    int countSolutions(const Grid& grid, int limit, Recorder& recorder) {
+        Grid work = grid;
+        CandidateMasks workMasks;
+        if (limit <= 0 || !workMasks.load(work)) return 0;
+        
+        trail.size = 0;
+        budget = 0;
+        if (!propagateSingles(work, workMasks, trail, recorder)) return 0;
+        
+        int row, col;
+        Mask candidates;
+        if (!findBestCell(work, workMasks, row, col, candidates, recorder)) {
+            return 1; // Solved by propagation alone
+        }
+        return search(work, workMasks, row, col, candidates, limit, recorder);
+    }
+
+    // Depth-first search from (row, col) over the given candidates, running
+    // singles propagation after every guess. grid and gridMasks are restored
+    // before returning.
+    template <typename Recorder>
+    int search(Grid& grid, CandidateMasks& gridMasks, int row, int col,
+               Mask candidates, int limit, Recorder& recorder) {
+        int count = 0;
+        int depth = 0;
+        int baseMark = trail.size;
+        uint64_t nodes = 0;
+        pushFrame(depth, row, col, candidates);
+        
+        while (depth > 0) {
+            Frame& frame = stack[depth - 1];
+            if (trail.size > frame.trailMark) {
+                recorder.backtrack();
+                undoTrail(grid, gridMasks, trail, frame.trailMark);
+            }
+            if (frame.remaining == 0) {
+                --depth;
+                continue;
+            }
+            
+            if (budget != 0 && ++nodes > budget) {
+                budget = OVER_BUDGET;
+                break;
+            }
+            
+            int num = lowestDigit(frame.remaining);
+            frame.remaining &= frame.remaining - 1;
+            recorder.node(depth);
+            placeOnTrail(grid, gridMasks, trail, Grid::index(frame.row, frame.col), num);
+            if (!propagateSingles(grid, gridMasks, trail, recorder)) continue;
+            
+            int nextRow, nextCol;
+            Mask next;
+            if (!findBestCell(grid, gridMasks, nextRow, nextCol, next, recorder)) {
+                if (++count >= limit) break;
+            } else if (next != 0) {
+                pushFrame(depth, nextRow, nextCol, next);
+            }
+        }
+        
+        // Unwind whatever an early exit left placed
+        undoTrail(grid, gridMasks, trail, baseMark);
+        return count;
+    }
+
+    void pushFrame(int& depth, int row, int col, Mask candidates) {
+        Frame& frame = stack[depth++];
+        frame.row = row;
+        frame.col = col;
+        frame.remaining = candidates;
+        frame.trailMark = trail.size;
+    }
+
+    Grid current;
+    CandidateMasks masks;
+    // Set in budget when a search stops early for running out of nodes
+    static const uint64_t OVER_BUDGET = ~static_cast<uint64_t>(0);
+    
+    Frame stack[Dimensions<BOX>::CELL_COUNT];
+    BasicPlacementTrail<BOX> trail;
+    uint64_t budget;    // Node cap for the current search, 0 for none
+    NullRecorder noStats;
+};
+
+// Exact-cover (Algorithm X / Dancing Links) solver. Each of the SIZE^3
+// possible placements is a matrix row covering four of 4 * CELL_COUNT
+// constraint columns: the cell is filled, and the digit appears once in its
+// row, column and box. The node pool is allocated and linked up once at
+// construction (a 25x25 pool runs to megabytes, too big for the stack);
+// givens are covered before a search and uncovered after it, so solving
+// never allocates and worst-case puzzles stay well behaved.
+template <int BOX>
+class BasicDlxSolver {
+public:
+    typedef BasicGrid<BOX> Grid;
+
+    BasicDlxSolver() { build(); }
+
+    // Fill grid with its first solution; returns false if there is none
+    bool solve(Grid& grid, SearchStats* stats = nullptr) {
+        Grid first;
+        if (countSolutions(grid, 1, &first, stats) == 0) return false;
+        grid = first;
+        return true;
+    }
+
+    // Count solutions of grid up to limit, optionally keeping the first one
+    int countSolutions(const Grid& grid, int limit, Grid* first = nullptr,
+                       SearchStats* stats = nullptr) {
+        if (limit <= 0) return 0;
+        solutionLimit = limit;
+        solutionCount = 0;
+        firstSolution = first;
+        depth = 0;
+        
+        bool valid = true;
+        for (int i = 0; i < CELL_COUNT && valid; ++i) {
+            if (grid.cells[i] == EMPTY) continue;
+            int row = i * SIZE + grid.cells[i] - 1;
+            valid = selectGiven(row);
+            if (valid) chosen[depth++] = row;
+        }
+        
+        int givens = depth;
+        givenCount = givens;
+        if (valid) {
+            if (stats) {
+                StatsRecorder recorder(*stats);
+                search(recorder);
+            } else {
+                NullRecorder recorder;
+                search(recorder);
+            }
+        }
+        
+        while (givens > 0) {
+            deselectRow(rowNode[chosen[--givens]]);
+        }
+        return valid ? solutionCount : 0;
+    }
+
+private:
+    static const int SIZE = Dimensions<BOX>::SIZE;
+    static const int CELL_COUNT = Dimensions<BOX>::CELL_COUNT;
+    static const int COLUMNS = 4 * CELL_COUNT;
+    static const int ROWS = CELL_COUNT * SIZE;
+    static const int ROOT = 0; // Column headers are nodes 1..COLUMNS
+    static const int NODES = 1 + COLUMNS + 4 * ROWS;
+
+    void build() {
+        left.resize(NODES);
+        right.resize(NODES);
+        up.resize(NODES);
+        down.resize(NODES);
+        column.resize(NODES);
+        rowOf.resize(NODES);
+        columnSize.resize(COLUMNS + 1);
+        rowNode.resize(ROWS);
+
+        for (int c = 0; c <= COLUMNS; ++c) {
+            left[c] = c == 0 ? COLUMNS : c - 1;
+            right[c] = c == COLUMNS ? 0 : c + 1;
+            up[c] = down[c] = c;
+            column[c] = c;
+            columnSize[c] = 0;
+        }
+        
+        int node = COLUMNS + 1;
+        for (int r = 0; r < SIZE; ++r) {
+            for (int c = 0; c < SIZE; ++c) {
+                int box = BasicCandidateMasks<BOX>::boxIndex(r, c);
+                for (int d = 0; d < SIZE; ++d) {
+                    int row = Grid::index(r, c) * SIZE + d;
+                    int columns[4] = {
+                        1 + Grid::index(r, c),
+                        1 + CELL_COUNT + r * SIZE + d,
+                        1 + 2 * CELL_COUNT + c * SIZE + d,
+                        1 + 3 * CELL_COUNT + box * SIZE + d
+                    };
+                    rowNode[row] = node;
+                    for (int k = 0; k < 4; ++k, ++node) {
+                        int col = columns[k];
+                        column[node] = col;
+                        rowOf[node] = row;
+                        up[node] = up[col];
+                        down[node] = col;
+                        down[up[col]] = node;
+                        up[col] = node;
+                        ++columnSize[col];
+                        left[node] = k == 0 ? node + 3 : node - 1;
+                        right[node] = k == 3 ? node - 3 : node + 1;
+                    }
+                }
+            }
+        }
+    }
+
+    void cover(int col) {
+        right[left[col]] = right[col];
+        left[right[col]] = left[col];
+        for (int i = down[col]; i != col; i = down[i]) {
+            for (int j = right[i]; j != i; j = right[j]) {
+                up[down[j]] = up[j];
+                down[up[j]] = down[j];
+                --columnSize[column[j]];
+            }
+        }
+    }
+
+    void uncover(int col) {
+        for (int i = up[col]; i != col; i = up[i]) {
+            for (int j = left[i]; j != i; j = left[j]) {
+                ++columnSize[column[j]];
+                up[down[j]] = j;
+                down[up[j]] = j;
+            }
+        }
+        right[left[col]] = col;
+        left[right[col]] = col;
+    }
+
+    bool isCovered(int col) const {
+        return right[left[col]] != col;
+    }
+
+    // A given conflicts with earlier ones if any of its columns is already covered
+    bool selectGiven(int row) {
+        int node = rowNode[row];
+        for (int k = 0; k < 4; ++k) {
+            if (isCovered(column[node + k])) return false;
+        }
+        cover(column[node]);
+        for (int j = right[node]; j != node; j = right[j]) {
+            cover(column[j]);
+        }
+        return true;
+    }
+
+    void deselectRow(int node) {
+        for (int j = left[node]; j != node; j = left[j]) {
+            uncover(column[j]);
+        }
+        uncover(column[node]);
+    }
+
+    template <typename Recorder>
+    void search(Recorder& recorder) {
+        if (right[ROOT] == ROOT) {
+            if (solutionCount == 0 && firstSolution) recordSolution(*firstSolution);
+            ++solutionCount;
+            return;
+        }
+        
+        // Column with the fewest remaining rows
+        uint64_t start = recorder.now();
+        int best = right[ROOT];
+        for (int c = right[best]; c != ROOT; c = right[c]) {
+            if (columnSize[c] < columnSize[best]) best = c;
+        }
+        recorder.selectTime(start);
+        if (columnSize[best] == 0) return;
+        
+        cover(best);
+        for (int r = down[best]; r != best; r = down[r]) {
+            chosen[depth++] = rowOf[r];
+            recorder.node(depth - givenCount);
+            for (int j = right[r]; j != r; j = right[j]) {
+                cover(column[j]);
+            }
+            
+            search(recorder);
+            
+            for (int j = left[r]; j != r; j = left[j]) {
+                uncover(column[j]);
+            }
+            --depth;
+            if (solutionCount >= solutionLimit) break;
+            recorder.backtrack();
+        }
+        uncover(best);
+    }
+
+    void recordSolution(Grid& grid) const {
+        for (int k = 0; k < depth; ++k) {
+            grid.cells[chosen[k] / SIZE] = chosen[k] % SIZE + 1;
+        }
+    }
+
+    std::vector<int> left, right, up, down;
+    std::vector<int> column, rowOf;
+    std::vector<int> columnSize;
+    std::vector<int> rowNode;
+    int chosen[CELL_COUNT];
+    int depth;
+    int solutionCount, solutionLimit;
+    int givenCount;
+    Grid* firstSolution;
+};
+
+// Search back-ends selectable for solving and counting
+enum SolverEngine {
+    BACKTRACKING,   // MRV backtracking over candidate masks
+    DANCING_LINKS,  // Exact cover with DLX
+    PARALLEL        // MRV backtracking split across a work-stealing pool
+};
+
+// Target clue counts for a 9x9 puzzle, which keeps between the value and the
+// value + 5. Larger and smaller boards scale both by their cell count.
+enum Difficulty {
+    EASY = 35,      // 35-40 clues
+    MEDIUM = 30,    // 30-35 clues
+    HARD = 25,      // 25-30 clues
+    EXPERT = 20     // 20-25 clues
+};
+
+// Clue patterns the generator can keep
+enum Symmetry {
+    SYMMETRY_NONE,
+    SYMMETRY_ROTATIONAL,    // 180-degree turn: (r, c) goes with (SIZE-1-r, SIZE-1-c)
+    SYMMETRY_MIRROR         // Left-right: (r, c) goes with (r, SIZE-1-c)
+};
+
+// Solving techniques a person would use, easiest first. A puzzle is rated
+// by the hardest one its logical solution needs.
+enum Technique {
+    TECHNIQUE_NONE,           // Nothing needed: the grid is already full
+    TECHNIQUE_NAKED_SINGLE,
+    TECHNIQUE_HIDDEN_SINGLE,
+    TECHNIQUE_POINTING,       // A digit confined to one line within a box leaves the rest of the line
+    TECHNIQUE_BOX_LINE,       // A digit confined to one box within a line leaves the rest of the box
+    TECHNIQUE_NAKED_PAIR,
+    TECHNIQUE_HIDDEN_PAIR,
+    TECHNIQUE_NAKED_TRIPLE,
+    TECHNIQUE_HIDDEN_TRIPLE,
+    TECHNIQUE_X_WING,
+    TECHNIQUE_SWORDFISH,
+    TECHNIQUE_BEYOND          // Stuck: needs guessing or a technique not listed here
+};
+
+inline const char* techniqueName(Technique technique) {
+    switch (technique) {
+        case TECHNIQUE_NONE: return "none";
+        case TECHNIQUE_NAKED_SINGLE: return "naked single";
+        case TECHNIQUE_HIDDEN_SINGLE: return "hidden single";
+        case TECHNIQUE_POINTING: return "pointing";
+        case TECHNIQUE_BOX_LINE: return "box-line reduction";
+        case TECHNIQUE_NAKED_PAIR: return "naked pair";
+        case TECHNIQUE_HIDDEN_PAIR: return "hidden pair";
+        case TECHNIQUE_NAKED_TRIPLE: return "naked triple";
+        case TECHNIQUE_HIDDEN_TRIPLE: return "hidden triple";
+        case TECHNIQUE_X_WING: return "X-wing";
+        case TECHNIQUE_SWORDFISH: return "swordfish";
+        case TECHNIQUE_BEYOND: break;
+    }
+    return "beyond logic";
+}
+
+// The difficulty a puzzle whose hardest technique is hardest plays at:
+// singles are easy, locked candidates medium, subsets and fish hard, and
+// anything past them expert
+inline Difficulty techniqueDifficulty(Technique hardest) {
+    if (hardest <= TECHNIQUE_HIDDEN_SINGLE) return EASY;
+    if (hardest <= TECHNIQUE_BOX_LINE) return MEDIUM;
+    if (hardest <= TECHNIQUE_SWORDFISH) return HARD;
+    return EXPERT;
+}
+
+// Solves the way a person would, with no guessing: each step applies the
+// easiest technique that places a digit or removes a candidate, and the
+// rating is the hardest technique any step used. Pencil marks are kept per
+// cell, since eliminations go beyond what the unit masks know. Singles are
+// found in the same order as the game's hints: naked singles by cell, then
+// hidden singles by digit and then unit.
+template <int BOX>
+class BasicLogicalSolver {
+public:
+    typedef BasicGrid<BOX> Grid;
+    typedef typename Dimensions<BOX>::Mask Mask;
+
+    // Solve puzzle as far as logic goes and return the hardest technique
+    // needed, or TECHNIQUE_BEYOND if it gets stuck (or the puzzle is invalid)
+    Technique rate(const Grid& puzzle) {
+        if (!load(puzzle)) return TECHNIQUE_BEYOND;
+        Technique hardest = TECHNIQUE_NONE;
+        while (empty > 0) {
+            Technique used = advance();
+            if (used == TECHNIQUE_BEYOND) return TECHNIQUE_BEYOND;
+            if (used > hardest) hardest = used;
+        }
+        return hardest;
+    }
+
+    // The first digit logic places on board, with the hardest technique
+    // needed to get there; false if logic finds none
+    bool nextPlacement(const Grid& board, int& cell, int& num, Technique& hardest) {
+        hardest = TECHNIQUE_NONE;
+        if (!load(board)) return false;
+        while (empty > 0) {
+            int before = empty;
+            Technique used = advance();
+            if (used == TECHNIQUE_BEYOND) return false;
+            if (used > hardest) hardest = used;
+            if (empty < before) {
+                cell = lastCell;
+                num = current.cells[lastCell];
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The grid as far as the last rate() or nextPlacement() got
+    const Grid& grid() const { return current; }
+
+private:
+    typedef Dimensions<BOX> Dim;
+    static const int SIZE = Dim::SIZE;
+
+    bool load(const Grid& puzzle) {
+        BasicCandidateMasks<BOX> masks;
+        if (!masks.load(puzzle)) return false;
+        current = puzzle;
+        empty = 0;
+        for (int i = 0; i < Dim::CELL_COUNT; ++i) {
+            marks[i] = current.cells[i] == EMPTY ? masks.candidates(i / SIZE, i % SIZE) : 0;
+            if (current.cells[i] == EMPTY) ++empty;
+        }
+        return true;
+    }
+
+    static const BasicUnitTable<BOX>& units() { return BasicUnitTable<BOX>::instance(); }
+
+    void place(int cell, int num) {
+        int row = cell / SIZE, col = cell % SIZE;
+        int unitOf[3] = {row, SIZE + col, 2 * SIZE + BasicCandidateMasks<BOX>::boxIndex(row, col)};
+        Mask bit = static_cast<Mask>(digitBit(num));
+        for (int u = 0; u < 3; ++u) {
+            for (int k = 0; k < SIZE; ++k) marks[units().cells[unitOf[u]][k]] &= ~bit;
+        }
+        current.cells[cell] = num;
+        marks[cell] = 0;
+        lastCell = cell;
+        --empty;
+    }
+
+    // Clear bits from cell's marks, reporting whether any were set
+    bool eliminate(int cell, Mask bits) {
+        if (!(marks[cell] & bits)) return false;
+        marks[cell] &= ~bits;
+        return true;
+    }
+
+    Technique advance() {
+        if (nakedSingle()) return TECHNIQUE_NAKED_SINGLE;
+        if (hiddenSingle()) return TECHNIQUE_HIDDEN_SINGLE;
+        if (pointing()) return TECHNIQUE_POINTING;
+        if (boxLine()) return TECHNIQUE_BOX_LINE;
+        if (nakedSubset(2)) return TECHNIQUE_NAKED_PAIR;
+        if (hiddenSubset(2)) return TECHNIQUE_HIDDEN_PAIR;
+        if (nakedSubset(3)) return TECHNIQUE_NAKED_TRIPLE;
+        if (hiddenSubset(3)) return TECHNIQUE_HIDDEN_TRIPLE;
+        if (fish(2)) return TECHNIQUE_X_WING;
+        if (fish(3)) return TECHNIQUE_SWORDFISH;
+        return TECHNIQUE_BEYOND;
+    }
+
+    bool nakedSingle() {
+        for (int i = 0; i < Dim::CELL_COUNT; ++i) {
+            if (current.cells[i] == EMPTY && marks[i] != 0 && (marks[i] & (marks[i] - 1)) == 0) {
+                place(i, lowestDigit(marks[i]));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool hiddenSingle() {
+        Mask hidden[Dim::UNIT_COUNT];
+        for (int u = 0; u < Dim::UNIT_COUNT; ++u) {
+            Mask once = 0, twice = 0;
+            for (int k = 0; k < SIZE; ++k) {
+                Mask candidates = marks[units().cells[u][k]];
+                twice |= once & candidates;
+                once |= candidates;
+            }
+            hidden[u] = once & ~twice;
+        }
+        
+        for (int num = 1; num <= SIZE; ++num) {
+            Mask bit = static_cast<Mask>(digitBit(num));
+            for (int u = 0; u < Dim::UNIT_COUNT; ++u) {
+                if (!(hidden[u] & bit)) continue;
+                for (int k = 0; k < SIZE; ++k) {
+                    int cell = units().cells[u][k];
+                    if (marks[cell] & bit) {
+                        place(cell, num);
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    // Where num is still possible in unit u, as a mask over the unit's cells
+    uint32_t positions(int u, Mask bit) const {
+        uint32_t where = 0;
+        for (int k = 0; k < SIZE; ++k) {
+            if (marks[units().cells[u][k]] & bit) where |= 1u << k;
+        }
+        return where;
+    }
+
+    bool pointing() {
+        // Cell k of a box unit sits on the box's row k / BOX and column k % BOX
+        for (int b = 0; b < SIZE; ++b) {
+            int boxUnit = 2 * SIZE + b;
+            int top = (b / BOX) * BOX, left = (b % BOX) * BOX;
+            for (int num = 1; num <= SIZE; ++num) {
+                Mask bit = static_cast<Mask>(digitBit(num));
+                uint32_t where = positions(boxUnit, bit);
+                if (where == 0) continue;
+                int rowsUsed = 0, colsUsed = 0;
+                for (int k = 0; k < SIZE; ++k) {
+                    if (where & (1u << k)) {
+                        rowsUsed |= 1 << (k / BOX);
+                        colsUsed |= 1 << (k % BOX);
+                    }
+                }
+                bool progress = false;
+                if ((rowsUsed & (rowsUsed - 1)) == 0) {
+                    int row = top + lowestDigit(static_cast<uint32_t>(rowsUsed)) - 1;
+                    for (int c = 0; c < SIZE; ++c) {
+                        if (c < left || c >= left + BOX) progress |= eliminate(Grid::index(row, c), bit);
+                    }
+                }
+                if ((colsUsed & (colsUsed - 1)) == 0) {
+                    int col = left + lowestDigit(static_cast<uint32_t>(colsUsed)) - 1;
+                    for (int r = 0; r < SIZE; ++r) {
+                        if (r < top || r >= top + BOX) progress |= eliminate(Grid::index(r, col), bit);
+                    }
+                }
+                if (progress) return true;
+            }
+        }
+        return false;
+    }
+
+    bool boxLine() {
+        for (int u = 0; u < 2 * SIZE; ++u) {
+            for (int num = 1; num <= SIZE; ++num) {
+                Mask bit = static_cast<Mask>(digitBit(num));
+                uint32_t where = positions(u, bit);
+                if (where == 0) continue;
+                // Along a line, cells k share a box when they share k / BOX
+                int bands = 0;
+                for (int k = 0; k < SIZE; ++k) {
+                    if (where & (1u << k)) bands |= 1 << (k / BOX);
+                }
+                if (bands & (bands - 1)) continue;
+                
+                int line = u % SIZE;
+                int band = lowestDigit(static_cast<uint32_t>(bands)) - 1;
+                int row = u < SIZE ? line : band * BOX;
+                int col = u < SIZE ? band * BOX : line;
+                int boxUnit = 2 * SIZE + BasicCandidateMasks<BOX>::boxIndex(row, col);
+                bool progress = false;
+                for (int k = 0; k < SIZE; ++k) {
+                    int cell = units().cells[boxUnit][k];
+                    int onLine = u < SIZE ? cell / SIZE : cell % SIZE;
+                    if (onLine != line) progress |= eliminate(cell, bit);
+                }
+                if (progress) return true;
+            }
+        }
+        return false;
+    }
+
+    // Call found(items, combined) for each choice of n of the count masks,
+    // each with 1 to n bits, whose union has exactly n bits, until found
+    // returns true
+    template <typename Found>
+    static bool forEachSubset(const uint32_t* masks, int count, int n, Found& found,
+                              int start = 0, int chosen = 0, uint32_t items = 0, uint32_t combined = 0) {
+        if (chosen == n) return countDigits(combined) == n && found(items, combined);
+        for (int i = start; i < count; ++i) {
+            int bits = countDigits(masks[i]);
+            if (bits == 0 || bits > n) continue;
+            uint32_t next = combined | masks[i];
+            if (countDigits(next) > n) continue;
+            if (forEachSubset(masks, count, n, found, i + 1, chosen + 1, items | (1u << i), next)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // n cells of a unit holding n digits between them: no other cell of
+    // the unit can have those digits
+    struct NakedElimination {
+        BasicLogicalSolver* self;
+        int unit;
+        bool operator()(uint32_t items, uint32_t digits) const {
+            bool progress = false;
+            for (int k = 0; k < SIZE; ++k) {
+                if (!(items & (1u << k))) {
+                    progress |= self->eliminate(units().cells[unit][k], static_cast<Mask>(digits));
+                }
+            }
+            return progress;
+        }
+    };
+
+    bool nakedSubset(int n) {
+        for (int u = 0; u < Dim::UNIT_COUNT; ++u) {
+            uint32_t masks[SIZE];
+            for (int k = 0; k < SIZE; ++k) masks[k] = marks[units().cells[u][k]];
+            NakedElimination found = {this, u};
+            if (forEachSubset(masks, SIZE, n, found)) return true;
+        }
+        return false;
+    }
+
+    // n digits of a unit confined to n cells: those cells hold nothing else
+    struct HiddenElimination {
+        BasicLogicalSolver* self;
+        int unit;
+        bool operator()(uint32_t digits, uint32_t cells) const {
+            // Item i is digit i + 1, so digits is already a digit mask
+            bool progress = false;
+            for (int k = 0; k < SIZE; ++k) {
+                if (cells & (1u << k)) {
+                    progress |= self->eliminate(units().cells[unit][k], static_cast<Mask>(~digits));
+                }
+            }
+            return progress;
+        }
+    };
+
+    bool hiddenSubset(int n) {
+        for (int u = 0; u < Dim::UNIT_COUNT; ++u) {
+            uint32_t masks[SIZE];
+            for (int num = 1; num <= SIZE; ++num) {
+                masks[num - 1] = positions(u, static_cast<Mask>(digitBit(num)));
+            }
+            HiddenElimination found = {this, u};
+            if (forEachSubset(masks, SIZE, n, found)) return true;
+        }
+        return false;
+    }
+
+    // A digit confined to the same n columns in n rows leaves those
+    // columns in every other row; the same holds with rows and columns
+    // swapped. n = 2 is an X-wing, n = 3 a swordfish.
+    struct FishElimination {
+        BasicLogicalSolver* self;
+        int base;            // 0 for rows as the base lines, SIZE for columns
+        Mask bit;
+        bool operator()(uint32_t lines, uint32_t crosses) const {
+            bool progress = false;
+            for (int line = 0; line < SIZE; ++line) {
+                if (lines & (1u << line)) continue;
+                for (int k = 0; k < SIZE; ++k) {
+                    if (crosses & (1u << k)) {
+                        progress |= self->eliminate(units().cells[base + line][k], bit);
+                    }
+                }
+            }
+            return progress;
+        }
+    };
+
+    bool fish(int n) {
+        for (int base = 0; base <= SIZE; base += SIZE) {
+            for (int num = 1; num <= SIZE; ++num) {
+                Mask bit = static_cast<Mask>(digitBit(num));
+                uint32_t masks[SIZE];
+                for (int line = 0; line < SIZE; ++line) masks[line] = positions(base + line, bit);
+                FishElimination found = {this, base, bit};
+                if (forEachSubset(masks, SIZE, n, found)) return true;
+            }
+        }
+        return false;
+    }
+
+    Grid current;
+    Mask marks[Dimensions<BOX>::CELL_COUNT];   // Pencil marks of empty cells, 0 for filled
+    int empty;
+    int lastCell;    // Cell of the latest placement
+};
+
+// MRV backtracking over candidate masks, propagating singles after every
+// guess. Given an RNG, each branch cell's candidates are tried in shuffled
+// order, which is how the generator draws random solutions. The search runs
+// on an explicit stack of CELL_COUNT frames held in the object, so machine
+// stack use does not grow with the board.
+template <int BOX>
+class BasicBacktracker {
+public:
+    typedef BasicGrid<BOX> Grid;
+    typedef BasicCandidateMasks<BOX> CandidateMasks;
+    typedef typename Dimensions<BOX>::Mask Mask;
+
+    explicit BasicBacktracker(std::mt19937* shuffleRng = nullptr) : rng(shuffleRng) {}
+
+    // Solve grid in place; on failure grid is left as it was
+    bool solve(Grid& grid, SearchStats* stats = nullptr) {
+        if (stats) {
+            StatsRecorder recorder(*stats);
+            return solve(grid, recorder);
+        }
+        NullRecorder recorder;
+        return solve(grid, recorder);
+    }
+
+private:
+    typedef BasicPlacementTrail<BOX> PlacementTrail;
+
+    template <typename Recorder>
+    bool solve(Grid& grid, Recorder& recorder) {
+        CandidateMasks masks;
+        if (!masks.load(grid)) return false;
+        
+        PlacementTrail trail;
+        if (!propagateSingles(grid, masks, trail, recorder) ||
+            !search(grid, masks, trail, recorder)) {
+            undoTrail(grid, masks, trail, 0);
+            return false;
+        }
+        return true;
+    }
+
+    struct Frame {
+        int cell;
+        int candidates[Dimensions<BOX>::SIZE];   // In the order they are tried
+        int count;
+        int next;        // Index of the next candidate to try
+        int trailMark;   // Trail size before this frame's guesses
+    };
+
+    // Depth-first search, leaving grid solved or returning false. A failed
+    // guess is undone when its frame comes round again.
+    template <typename Recorder>
+    bool search(Grid& grid, CandidateMasks& masks, PlacementTrail& trail, Recorder& recorder) {
+        int depth = 0;
+        if (!pushBranch(grid, masks, trail, depth, recorder)) return true;
+        
+        while (depth > 0) {
+            Frame& frame = stack[depth - 1];
+            if (trail.size > frame.trailMark) {
+                recorder.backtrack();
+                undoTrail(grid, masks, trail, frame.trailMark);
+            }
+            if (frame.next == frame.count) {
+                --depth;
+                continue;
+            }
+            
+            recorder.node(depth);
+            placeOnTrail(grid, masks, trail, frame.cell, frame.candidates[frame.next++]);
+            
+            // Fill in everything the guess forces before branching again
+            if (propagateSingles(grid, masks, trail, recorder) &&
+                !pushBranch(grid, masks, trail, depth, recorder)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Push a frame for the best branch cell; false when the grid is full.
+    // A dead end pushes a frame with no candidates.
+    template <typename Recorder>
+    bool pushBranch(const Grid& grid, const CandidateMasks& masks, const PlacementTrail& trail,
+                    int& depth, Recorder& recorder) {
+        int row, col;
+        Mask mask;
+        if (!findBestCell(grid, masks, row, col, mask, recorder)) return false;
+        
+        Frame& frame = stack[depth++];
+        frame.cell = Grid::index(row, col);
+        frame.count = 0;
+        frame.next = 0;
+        frame.trailMark = trail.size;
+        for (; mask; mask &= mask - 1) {
+            frame.candidates[frame.count++] = lowestDigit(mask);
+        }
+        if (rng) shuffleRange(frame.candidates, frame.candidates + frame.count, *rng);
+        return true;
+    }
+
+    std::mt19937* rng;
+    Frame stack[Dimensions<BOX>::CELL_COUNT];
+};
+
+// Depth-first search for one puzzle that advances a guess at a time, with
+// Backtracker's semantics: the same cell choice, ascending candidate order,
+// singles propagation after every guess, so it reaches the same first
+// solution. All state lives in the object, on a fixed explicit stack, so
+// many searches can be kept in flight and stepped in any order, and one
+// can be paused after a node budget with run() and resumed later, on any
+// thread. skipSolution() continues past a solution, so the solutions can
+// be counted a slice at a time too.
+template <int BOX>
+class BasicSearchState {
+public:
+    typedef BasicGrid<BOX> Grid;
+    typedef typename Dimensions<BOX>::Mask Mask;
+
+    enum Status {
+        RUNNING,
+        SOLVED,
+        UNSOLVABLE
+    };
+
+    BasicSearchState() : depth(0), state(UNSOLVABLE), guesses(0) {}
+
+    // Begin searching puzzle; it may already be settled by propagation
+    Status start(const Grid& puzzle) {
+        grid = puzzle;
+        depth = 0;
+        trail.size = 0;
+        guesses = 0;
+        if (!masks.load(grid) || !propagateSingles(grid, masks, trail)) return state = UNSOLVABLE;
+        return branch();
+    }
+
+    // Undo a failed guess or try the next one, then propagate
+    Status step() {
+        if (state != RUNNING) return state;
+        
+        Frame& frame = stack[depth - 1];
+        if (trail.size > frame.trailMark) {
+            undoTrail(grid, masks, trail, frame.trailMark);
+        }
+        if (frame.remaining == 0) {
+            if (--depth == 0) state = UNSOLVABLE;
+            return state;
+        }
+        
+        int num = lowestDigit(frame.remaining);
+        frame.remaining &= frame.remaining - 1;
+        ++guesses;
+        placeOnTrail(grid, masks, trail, Grid::index(frame.row, frame.col), num);
+        if (!propagateSingles(grid, masks, trail)) return state;
+        return branch();
+    }
+
+    // Step until the search settles or nodeBudget more guesses are spent
+    // (0 for no cap). RUNNING means it paused with work left; call again to
+    // go on.
+    Status run(uint64_t nodeBudget = 0) {
+        uint64_t stopAt = guesses + nodeBudget;
+        while (state == RUNNING && (nodeBudget == 0 || guesses < stopAt)) step();
+        return state;
+    }
+
+    // Go on from a solution to look for the next one: RUNNING if there is
+    // still tree left to search, UNSOLVABLE once none is
+    Status skipSolution() {
+        if (state == SOLVED) state = depth == 0 ? UNSOLVABLE : RUNNING;
+        return state;
+    }
+
+    Status status() const { return state; }
+
+    // Guesses made since start()
+    uint64_t nodes() const { return guesses; }
+
+    // Rough share of the search tree behind us, from 0 to 1, counting the
+    // branches of every open frame as equally large
+    double explored() const {
+        double done = 0, scale = 1;
+        for (int d = 0; d < depth; ++d) {
+            int tried = stack[d].total - countDigits(stack[d].remaining);
+            done += scale * std::max(tried - 1, 0) / stack[d].total;
+            scale /= stack[d].total;
+        }
+        return state == RUNNING ? done : 1.0;
+    }
+
+    // The solution once SOLVED
+    const Grid& solution() const { return grid; }
+
+private:
+    struct Frame {
+        int row, col;
+        Mask remaining;
+        int total;       // Candidates the frame started with
+        int trailMark;   // Trail size before this frame's guess
+    };
+
+    // Push the next branch cell, or finish when the grid is full. A dead
+    // end pushes nothing; the next step() undoes the guess that caused it.
+    Status branch() {
+        int row, col;
+        Mask candidates;
+        if (!findBestCell(grid, masks, row, col, candidates)) return state = SOLVED;
+        if (candidates != 0) {
+            Frame& frame = stack[depth++];
+            frame.row = row;
+            frame.col = col;
+            frame.remaining = candidates;
+            frame.total = countDigits(candidates);
+            frame.trailMark = trail.size;
+        } else if (depth == 0) {
+            return state = UNSOLVABLE;
+        }
+        return state = RUNNING;
+    }
+
+    Grid grid;
+    BasicCandidateMasks<BOX> masks;
+    BasicPlacementTrail<BOX> trail;
+    Frame stack[Dimensions<BOX>::CELL_COUNT];
+    int depth;
+    Status state;
+    uint64_t guesses;
+};
+
+#if defined(__AVX2__)
+#define SUDOKU_LANE_BYTES 32
+#else
+#define SUDOKU_LANE_BYTES 16
+#endif
+
+// One mask per puzzle of a batch, operated on together. GCC and Clang map
+// this onto SIMD registers (16 bytes, or 32 with AVX2); elsewhere it is a
+// plain array with element-wise operators.
+template <typename Mask>
+struct LaneTraits {
+    static const int LANES = SUDOKU_LANE_BYTES / sizeof(Mask);
+#if defined(__GNUC__) || defined(__clang__)
+    // Element alignment only, so a solver can live anywhere operator new
+    // puts it; C++11 allocation ignores the 32-byte alignment of AVX types
+    typedef Mask Lanes __attribute__((vector_size(SUDOKU_LANE_BYTES), aligned(sizeof(Mask))));
+
+    static Lanes broadcast(Mask value) {
+        Lanes lanes = {};
+        return lanes + value;
+    }
+    // All ones in lanes where value is 0
+    static Lanes zeroLanes(Lanes value) {
+        return reinterpret_cast<Lanes>(value == broadcast(0));
+    }
+#else
+    struct Lanes {
+        Mask v[LANES];
+
+        Mask& operator[](int lane) { return v[lane]; }
+        Mask operator[](int lane) const { return v[lane]; }
+        Lanes operator|(const Lanes& o) const { Lanes r; for (int l = 0; l < LANES; ++l) r.v[l] = v[l] | o.v[l]; return r; }
+        Lanes operator&(const Lanes& o) const { Lanes r; for (int l = 0; l < LANES; ++l) r.v[l] = v[l] & o.v[l]; return r; }
+        Lanes operator^(const Lanes& o) const { Lanes r; for (int l = 0; l < LANES; ++l) r.v[l] = v[l] ^ o.v[l]; return r; }
+        Lanes operator-(const Lanes& o) const { Lanes r; for (int l = 0; l < LANES; ++l) r.v[l] = v[l] - o.v[l]; return r; }
+        Lanes operator~() const { Lanes r; for (int l = 0; l < LANES; ++l) r.v[l] = ~v[l]; return r; }
+        Lanes& operator|=(const Lanes& o) { return *this = *this | o; }
+        Lanes& operator&=(const Lanes& o) { return *this = *this & o; }
+    };
+
+    static Lanes broadcast(Mask value) {
+        Lanes lanes;
+        for (int l = 0; l < LANES; ++l) lanes.v[l] = value;
+        return lanes;
+    }
+    static Lanes zeroLanes(Lanes value) {
+        Lanes lanes;
+        for (int l = 0; l < LANES; ++l) lanes.v[l] = value.v[l] == 0 ? static_cast<Mask>(~0u) : 0;
+        return lanes;
+    }
+#endif
+};
+
+// Throughput solver for many puzzles at once, a block of LANES at a time.
+// Almost all of the work in solving typical puzzles is the singles
+// propagation at the root, so that runs in lockstep across the block: each
+// mask holds one value per puzzle, and every step is branch-free lane
+// arithmetic. Puzzles propagation does not finish are searched by
+// BasicSearchState lanes, stepped round-robin one guess each, so one
+// search's stalls overlap the others' work. Results match Backtracker
+// puzzle for puzzle.
+template <int BOX>
+class BasicBatchSolver {
+public:
+    typedef BasicGrid<BOX> Grid;
+    typedef BasicSearchState<BOX> SearchState;
+    typedef typename Dimensions<BOX>::Mask Mask;
+    typedef LaneTraits<Mask> Traits;
+    typedef typename Traits::Lanes Lanes;
+
+    static const int LANES = Traits::LANES;
+
+    // Solve count puzzles in place. solved[i] reports whether puzzles[i]
+    // was solved; the ones that were not are left as given. Returns the
+    // number solved.
+    size_t solve(Grid* puzzles, size_t count, bool* solved) {
+        size_t total = 0;
+        for (size_t first = 0; first < count; first += LANES) {
+            int lanes = static_cast<int>(std::min(count - first, static_cast<size_t>(LANES)));
+            total += solveBlock(puzzles + first, lanes, solved + first);
+        }
+        return total;
+    }
+
+private:
+    typedef Dimensions<BOX> Dim;
+
+    size_t solveBlock(Grid* puzzles, int lanes, bool* solved) {
+        load(puzzles, lanes);
+        propagate();
+        
+        size_t total = 0;
+        int searching = 0;
+        for (int l = 0; l < lanes; ++l) {
+            solved[l] = false;
+            if (dead[l]) continue;
+            
+            Grid grid;
+            bool full = true;
+            for (int i = 0; i < Dim::CELL_COUNT; ++i) {
+                Mask bit = cells[i][l];
+                grid.cells[i] = bit ? lowestDigit(bit) : EMPTY;
+                full = full && bit != 0;
+            }
+            if (full) {
+                puzzles[l] = grid;
+                solved[l] = true;
+                ++total;
+            } else if (search[searching].start(grid) != SearchState::UNSOLVABLE) {
+                searchLane[searching++] = l;
+            }
+        }
+        
+        // Round-robin over the searches, dropping each as it finishes
+        while (searching > 0) {
+            for (int k = 0; k < searching; ) {
+                typename SearchState::Status status = search[k].step();
+                if (status == SearchState::RUNNING) {
+                    ++k;
+                    continue;
+                }
+                if (status == SearchState::SOLVED) {
+                    puzzles[searchLane[k]] = search[k].solution();
+                    solved[searchLane[k]] = true;
+                    ++total;
+                }
+                --searching;
+                std::swap(search[k], search[searching]);
+                std::swap(searchLane[k], searchLane[searching]);
+            }
+        }
+        return total;
+    }
+
+    // Spread the block over the lanes; lanes without a puzzle start dead
+    void load(const Grid* puzzles, int lanes) {
+        Lanes zero = Traits::broadcast(0);
+        dead = zero;
+        for (int l = lanes; l < LANES; ++l) {
+            dead[l] = 1;
+        }
+        for (int i = 0; i < Dim::SIZE; ++i) {
+            rows[i] = cols[i] = boxes[i] = zero;
+        }
+        for (int r = 0; r < Dim::SIZE; ++r) {
+            for (int c = 0; c < Dim::SIZE; ++c) {
+                int i = Grid::index(r, c);
+                int b = BasicCandidateMasks<BOX>::boxIndex(r, c);
+                cells[i] = zero;
+                for (int l = 0; l < lanes; ++l) {
+                    int num = puzzles[l].cells[i];
+                    if (num == EMPTY) continue;
+                    Mask bit = digitBit(num);
+                    // A given that repeats one in its row, column or box
+                    if ((rows[r][l] | cols[c][l] | boxes[b][l]) & bit) dead[l] = 1;
+                    cells[i][l] = bit;
+                    rows[r][l] |= bit;
+                    cols[c][l] |= bit;
+                    boxes[b][l] |= bit;
+                }
+            }
+        }
+    }
+
+    // Candidates of cell i in each lane, none where it is filled
+    Lanes candidates(int i, int r, int c, int b, Lanes all) const {
+        return Traits::zeroLanes(cells[i]) & all & ~(rows[r] | cols[c] | boxes[b]);
+    }
+
+    void place(int i, int r, int c, int b, Lanes bits) {
+        cells[i] |= bits;
+        rows[r] |= bits;
+        cols[c] |= bits;
+        boxes[b] |= bits;
+    }
+
+    // Naked and hidden singles to a fixpoint in every lane, with the same
+    // contradictions as propagateSingles() marking a lane dead
+    void propagate() {
+        const BasicUnitTable<BOX>& units = BasicUnitTable<BOX>::instance();
+        const Lanes all = Traits::broadcast(Dim::ALL_DIGITS);
+        const Lanes one = Traits::broadcast(1);
+        const Lanes zero = Traits::broadcast(0);
+        bool progress = true;
+        
+        while (progress) {
+            Lanes changed = zero;
+            
+            // Naked singles
+            for (int r = 0; r < Dim::SIZE; ++r) {
+                for (int c = 0; c < Dim::SIZE; ++c) {
+                    int i = Grid::index(r, c);
+                    int b = BasicCandidateMasks<BOX>::boxIndex(r, c);
+                    Lanes options = candidates(i, r, c, b, all);
+                    dead |= Traits::zeroLanes(options) & Traits::zeroLanes(cells[i]);
+                    Lanes single = Traits::zeroLanes(options & (options - one)) & options;
+                    place(i, r, c, b, single);
+                    changed |= single;
+                }
+            }
+            
+            // Hidden singles: digits allowed in exactly one empty cell of a unit
+            for (int u = 0; u < Dim::UNIT_COUNT; ++u) {
+                Lanes once = zero, twice = zero, filled = zero;
+                for (int k = 0; k < Dim::SIZE; ++k) {
+                    int i = units.cells[u][k];
+                    int r = i / Dim::SIZE, c = i % Dim::SIZE;
+                    Lanes options = candidates(i, r, c, BasicCandidateMasks<BOX>::boxIndex(r, c), all);
+                    twice |= once & options;
+                    once |= options;
+                    filled |= cells[i];
+                }
+                dead |= ~Traits::zeroLanes((once | filled) ^ all);
+                Lanes hidden = once & ~twice & ~filled;
+                
+                for (int k = 0; k < Dim::SIZE; ++k) {
+                    int i = units.cells[u][k];
+                    int r = i / Dim::SIZE, c = i % Dim::SIZE;
+                    int b = BasicCandidateMasks<BOX>::boxIndex(r, c);
+                    Lanes bits = hidden & candidates(i, r, c, b, all);
+                    // Two hidden digits in one cell: only one can go there
+                    Lanes rest = bits & (bits - one);
+                    dead |= ~Traits::zeroLanes(rest);
+                    bits &= ~rest;
+                    place(i, r, c, b, bits);
+                    hidden &= ~bits;
+                    changed |= bits;
+                }
+                
+                // A hidden digit whose only cell was taken by another single
+                dead |= ~Traits::zeroLanes(hidden);
+            }
+            
+            progress = false;
+            for (int l = 0; l < LANES; ++l) {
+                progress = progress || (changed[l] != 0 && dead[l] == 0);
+            }
+        }
+    }
+
+    // Digit bit of each filled cell, 0 for empty
+    Lanes cells[Dim::CELL_COUNT];
+    Lanes rows[Dim::SIZE];
+    Lanes cols[Dim::SIZE];
+    Lanes boxes[Dim::SIZE];
+    Lanes dead;    // Nonzero in lanes that have hit a contradiction
+
+    SearchState search[LANES];
+    int searchLane[LANES];
+};
+
+// MRV backtracking for a single hard puzzle, spread over a pool of threads.
+// Nodes less than splitDepth guesses deep are expanded into tasks, one per
+// candidate, each carrying its own grid and masks; below that a task is
+// searched depth-first on the spot. Every worker owns a deque of tasks: it
+// pops its newest, and when that runs dry steals the oldest task of another
+// worker, the shallowest and so the largest subtree left. All workers poll
+// one stop flag between guesses. It is raised when the limit of solutions
+// is in (the first one, for solve()) or by cancel(), so the pool winds down
+// within a guess of the answer. Threads are started per call and the
+// calling thread is one of them.
+template <int BOX>
+class BasicParallelSolver {
+public:
+    typedef BasicGrid<BOX> Grid;
+    typedef BasicCandidateMasks<BOX> CandidateMasks;
+    typedef typename Dimensions<BOX>::Mask Mask;
+
+    static const int DEFAULT_SPLIT_DEPTH = 6;
+
+    // threadCount 0 uses every core
+    explicit BasicParallelSolver(int threadCount = 0, int splitDepth = DEFAULT_SPLIT_DEPTH)
+        : threads(threadCount), split(splitDepth), limit(1), stop(false), found(0), pending(0) {}
+
+    void setThreads(int threadCount) { threads = threadCount; }
+    int getThreads() const { return threads; }
+
+    // Solve grid in place with the first solution any worker reaches (the
+    // only one, for a proper puzzle). Returns false, leaving grid as it was,
+    // if there is none or the search was cancelled first.
+    bool solve(Grid& grid, SearchStats* stats = nullptr) {
+        if (run(grid, 1, stats) == 0) return false;
+        grid = first;
+        return true;
+    }
+
+    // Count solutions of grid, stopping once limit is reached. A cancelled
+    // count returns the solutions seen so far.
+    int countSolutions(const Grid& grid, int solutionLimit, SearchStats* stats = nullptr) {
+        return run(grid, solutionLimit, stats);
+    }
+
+    // Stop the search in progress; safe to call from any thread
+    void cancel() { stop.store(true); }
+
+private:
+    typedef BasicPlacementTrail<BOX> PlacementTrail;
+
+    struct Task {
+        Grid grid;
+        CandidateMasks masks;
+        int depth;       // Guesses made above this task
+    };
+
+    struct Frame {
+        int row, col;
+        Mask remaining;
+        int trailMark;   // Trail size before this frame's guess
+    };
+
+    // Per-thread state; only tasks is shared, with thieves, under lock
+    struct Worker {
+        std::mutex lock;
+        std::deque<Task> tasks;
+        PlacementTrail trail;
+        Frame stack[Dimensions<BOX>::CELL_COUNT];
+        SearchStats stats;
+    };
+
+    int run(const Grid& grid, int solutionLimit, SearchStats* stats) {
+        int count = threads > 0 ? threads : static_cast<int>(std::thread::hardware_concurrency());
+        if (count <= 0) count = 1;
+        if (static_cast<int>(workers.size()) != count) {
+            workers.clear();
+            for (int i = 0; i < count; ++i) workers.emplace_back(new Worker());
+        }
+        for (int i = 0; i < count; ++i) {
+            workers[i]->tasks.clear();
+            workers[i]->stats = SearchStats();
+        }
+        
+        limit = solutionLimit;
+        found.store(0);
+        stop.store(false);
+        pending.store(0);
+        
+        Task root;
+        root.grid = grid;
+        root.depth = 0;
+        if (solutionLimit <= 0 || !root.masks.load(root.grid)) return 0;
+        
+        Worker& main = *workers[0];
+        main.trail.size = 0;
+        bool consistent;
+        if (stats) {
+            StatsRecorder recorder(main.stats);
+            consistent = propagateSingles(root.grid, root.masks, main.trail, recorder);
+        } else {
+            consistent = propagateSingles(root.grid, root.masks, main.trail);
+        }
+        main.trail.size = 0;
+        int row, col;
+        Mask candidates;
+        if (consistent && !findBestCell(root.grid, root.masks, row, col, candidates)) {
+            record(root.grid);  // Solved by propagation alone; no pool needed
+        } else if (consistent) {
+            pending.store(1);
+            main.tasks.push_back(root);
+            
+            std::vector<std::thread> pool;
+            for (int i = 1; i < count; ++i) {
+                pool.emplace_back(&BasicParallelSolver::work, this, i, stats != nullptr);
+            }
+            work(0, stats != nullptr);
+            for (size_t i = 0; i < pool.size(); ++i) pool[i].join();
+        }
+        
+        if (stats) {
+            for (int i = 0; i < count; ++i) {
+                const SearchStats& part = workers[i]->stats;
+                stats->nodes += part.nodes;
+                stats->backtracks += part.backtracks;
+                stats->propagations += part.propagations;
+                stats->maxDepth = std::max(stats->maxDepth, part.maxDepth);
+                stats->selectNanos += part.selectNanos;
+                stats->propagateNanos += part.propagateNanos;
+            }
+        }
+        return std::min(found.load(), limit);
+    }
+
+    void work(int self, bool withStats) {
+        if (withStats) {
+            StatsRecorder recorder(workers[self]->stats);
+            drain(self, recorder);
+        } else {
+            NullRecorder recorder;
+            drain(self, recorder);
+        }
+    }
+
+    // Run tasks until the search stops or every task is done. A worker finds
+    // its own deque and every other one empty while pending is non-zero when
+    // the remaining tasks are still being expanded elsewhere, and waits.
+    template <typename Recorder>
+    void drain(int self, Recorder& recorder) {
+        Worker& worker = *workers[self];
+        Task task;
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (!take(self, task)) {
+                if (pending.load() == 0) break;
+                std::this_thread::yield();
+                continue;
+            }
+            if (task.depth < split) {
+                expand(worker, task, recorder);
+            } else {
+                searchBelow(worker, task, recorder);
+            }
+            pending.fetch_sub(1);
+        }
+    }
+
+    // Pop the newest task of our own deque, or steal the oldest of another's
+    bool take(int self, Task& task) {
+        int count = static_cast<int>(workers.size());
+        for (int k = 0; k < count; ++k) {
+            Worker& victim = *workers[(self + k) % count];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (victim.tasks.empty()) continue;
+            if (k == 0) {
+                task = victim.tasks.back();
+                victim.tasks.pop_back();
+            } else {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // Split a shallow task into one propagated child per candidate of its
+    // branch cell. Children are pushed in descending order so the owner
+    // pops them in the sequential search's ascending order.
+    template <typename Recorder>
+    void expand(Worker& worker, const Task& task, Recorder& recorder) {
+        int row, col;
+        Mask candidates;
+        if (!findBestCell(task.grid, task.masks, row, col, candidates, recorder)) {
+            record(task.grid);
+            return;
+        }
+        
+        int digits[Dimensions<BOX>::SIZE];
+        int digitCount = 0;
+        for (; candidates; candidates &= candidates - 1) {
+            digits[digitCount++] = lowestDigit(candidates);
+        }
+        
+        Task child;
+        for (int i = digitCount - 1; i >= 0; --i) {
+            child = task;
+            child.depth = task.depth + 1;
+            recorder.node(child.depth);
+            worker.trail.size = 0;
+            placeOnTrail(child.grid, child.masks, worker.trail, Grid::index(row, col), digits[i]);
+            if (!propagateSingles(child.grid, child.masks, worker.trail, recorder)) {
+                recorder.backtrack();
+                continue;
+            }
+            pending.fetch_add(1);
+            std::lock_guard<std::mutex> guard(worker.lock);
+            worker.tasks.push_back(child);
+        }
+        worker.trail.size = 0;
+    }
+
+    // Depth-first search of a deep task on an explicit stack, the
+    // uniqueness checker's loop with a stop check before every guess
+    template <typename Recorder>
+    void searchBelow(Worker& worker, Task& task, Recorder& recorder) {
+        Grid& grid = task.grid;
+        CandidateMasks& masks = task.masks;
+        PlacementTrail& trail = worker.trail;
+        trail.size = 0;
+        
+        int row, col;
+        Mask candidates;
+        if (!findBestCell(grid, masks, row, col, candidates, recorder)) {
+            record(grid);
+            return;
+        }
+        int depth = 0;
+        if (candidates != 0) pushFrame(worker, depth, row, col, candidates);
+        
+        while (depth > 0 && !stop.load(std::memory_order_relaxed)) {
+            Frame& frame = worker.stack[depth - 1];
+            if (trail.size > frame.trailMark) {
+                recorder.backtrack();
+                undoTrail(grid, masks, trail, frame.trailMark);
+            }
+            if (frame.remaining == 0) {
+                --depth;
+                continue;
+            }
+            
+            int num = lowestDigit(frame.remaining);
+            frame.remaining &= frame.remaining - 1;
+            recorder.node(task.depth + depth);
+            placeOnTrail(grid, masks, trail, Grid::index(frame.row, frame.col), num);
+            if (!propagateSingles(grid, masks, trail, recorder)) continue;
+            
+            if (!findBestCell(grid, masks, row, col, candidates, recorder)) {
+                record(grid);
+            } else if (candidates != 0) {
+                pushFrame(worker, depth, row, col, candidates);
+            }
+        }
+        // A stop leaves placements behind; they belong to the task's copy
+        trail.size = 0;
+    }
+
+    void pushFrame(Worker& worker, int& depth, int row, int col, Mask candidates) {
+        Frame& frame = worker.stack[depth++];
+        frame.row = row;
+        frame.col = col;
+        frame.remaining = candidates;
+        frame.trailMark = worker.trail.size;
+    }
+
+    // Count a solution; the first one is kept, and the limit stops the pool
+    void record(const Grid& grid) {
+        int index = found.fetch_add(1);
+        if (index == 0) first = grid;
+        if (index + 1 >= limit) stop.store(true);
+    }
+
+    int threads;
+    int split;
+    int limit;
+    std::atomic<bool> stop;
+    std::atomic<int> found;
+    std::atomic<int> pending;   // Tasks queued or running
+    Grid first;
+    std::vector<std::unique_ptr<Worker> > workers;
+};
+
+// Solving and solution counting over the selectable engines
+template <int BOX>
+class BasicSolver {
+public:
+    typedef BasicGrid<BOX> Grid;
+
+    explicit BasicSolver(SolverEngine solverEngine = BACKTRACKING) : engine(solverEngine) {}
+
+    void setEngine(SolverEngine solverEngine) { engine = solverEngine; }
+    SolverEngine getEngine() const { return engine; }
+
+    // Threads for the PARALLEL engine (0, the default, uses every core)
+    void setThreads(int threadCount) { parallel.setThreads(threadCount); }
+
+    // Solve grid in place; returns false, leaving grid as it was, if there is no solution
+    bool solve(Grid& grid, SearchStats* stats = nullptr) {
+        if (engine == DANCING_LINKS) return dlx.solve(grid, stats);
+        if (engine == PARALLEL) return parallel.solve(grid, stats);
+        return backtracker.solve(grid, stats);
+    }
+
+    // Count solutions of grid, stopping once limit is reached
+    int countSolutions(const Grid& grid, int limit, SearchStats* stats = nullptr) {
+        if (engine == DANCING_LINKS) return dlx.countSolutions(grid, limit, nullptr, stats);
+        if (engine == PARALLEL) return parallel.countSolutions(grid, limit, stats);
+        return checker.countSolutions(grid, limit, stats);
+    }
+
+    bool hasUniqueSolution(const Grid& grid) {
+        return countSolutions(grid, 2) == 1;
+    }
+
+private:
+    SolverEngine engine;
+    BasicBacktracker<BOX> backtracker;
+    BasicUniquenessChecker<BOX> checker;
+    BasicDlxSolver<BOX> dlx;
+    BasicParallelSolver<BOX> parallel;
+};
+
+// Cancellation, deadline and progress reporting for long-running work.
+// Copies share one cancel flag, so a caller keeps a copy and may cancel()
+// from any thread while the work polls shouldStop() between slices. The
+// progress callback receives the fraction done, from 0 to 1, on the
+// thread doing the work.
+class TaskControl {
+public:
+    typedef std::chrono::steady_clock Clock;
+    typedef std::function<void(double)> ProgressCallback;
+
+    TaskControl() : flag(std::make_shared<std::atomic<bool> >(false)),
+                    deadline(Clock::time_point::max()) {}
+
+    void cancel() const { flag->store(true); }
+    bool cancelled() const { return flag->load(std::memory_order_relaxed); }
+
+    void setDeadline(Clock::time_point when) { deadline = when; }
+    bool expired() const { return deadline != Clock::time_point::max() && Clock::now() >= deadline; }
+
+    void setProgress(const ProgressCallback& callback) { progress = callback; }
+    void report(double fraction) const {
+        if (progress) progress(fraction);
+    }
+
+    bool shouldStop() const { return cancelled() || expired(); }
+
+private:
+    std::shared_ptr<std::atomic<bool> > flag;
+    Clock::time_point deadline;
+    ProgressCallback progress;
+};
+
+// A symmetry of the board: optional transposition, then a row order that
+// keeps bands together and a column order that keeps stacks together,
+// then a relabelling of the digits. Every transform maps solutions to
+// solutions, so a puzzle and its image are the same puzzle to a solver.
+// Cell (r, c) of the image is digits[n] for the digit n at source(r, c).
+template <int BOX>
+struct BasicTransform {
+    typedef Dimensions<BOX> Dim;
+    typedef BasicGrid<BOX> Grid;
+
+    bool transpose;
+    uint8_t rows[Dim::SIZE];
+    uint8_t cols[Dim::SIZE];
+    uint8_t digits[Dim::SIZE + 1];  // digits[EMPTY] is EMPTY
+
+    BasicTransform() : transpose(false) {
+        for (int i = 0; i < Dim::SIZE; ++i) {
+            rows[i] = cols[i] = i;
+        }
+        for (int n = 0; n <= Dim::SIZE; ++n) {
+            digits[n] = n;
+        }
+    }
+
+    // Index in the source grid of cell (row, col) of the image
+    int source(int row, int col) const {
+        return transpose ? Grid::index(cols[col], rows[row]) : Grid::index(rows[row], cols[col]);
+    }
+
+    void apply(const Grid& from, Grid& to) const {
+        for (int r = 0; r < Dim::SIZE; ++r) {
+            for (int c = 0; c < Dim::SIZE; ++c) {
+                to(r, c) = digits[from.cells[source(r, c)]];
+            }
+        }
+    }
+
+    // The inverse of apply(): to becomes the grid whose image is from
+    void revert(const Grid& from, Grid& to) const {
+        uint8_t inverse[Dim::SIZE + 1];
+        for (int n = 0; n <= Dim::SIZE; ++n) {
+            inverse[digits[n]] = n;
+        }
+        for (int r = 0; r < Dim::SIZE; ++r) {
+            for (int c = 0; c < Dim::SIZE; ++c) {
+                to.cells[source(r, c)] = inverse[from(r, c)];
+            }
+        }
+    }
+
+    // Draw a random transform. With a symmetry, only transforms that keep a
+    // clue pattern with that symmetry symmetric are drawn: a rotational
+    // pattern needs row and column orders that commute with reversal, and
+    // a mirror pattern needs such a column order and no transposition.
+    void randomize(std::mt19937& rng, Symmetry symmetry = SYMMETRY_NONE) {
+        transpose = symmetry != SYMMETRY_MIRROR && randomBelow(rng, 2) != 0;
+        shuffleLines(rng, rows, symmetry == SYMMETRY_ROTATIONAL);
+        shuffleLines(rng, cols, symmetry != SYMMETRY_NONE);
+        for (int n = 0; n <= Dim::SIZE; ++n) {
+            digits[n] = n;
+        }
+        shuffleRange(digits + 1, digits + Dim::SIZE + 1, rng);
+    }
+
+private:
+    // A random order of SIZE rows or columns that keeps each group of BOX
+    // together, commuting with reversal if symmetric
+    static void shuffleLines(std::mt19937& rng, uint8_t* order, bool symmetric) {
+        uint8_t groups[BOX];
+        shuffleOrder(rng, groups, BOX, symmetric);
+        for (int g = 0; g < BOX; ++g) {
+            uint8_t within[BOX];
+            int mirror = BOX - 1 - g;
+            if (symmetric && mirror < g) {
+                // Reflect the order already drawn for the mirror group
+                for (int k = 0; k < BOX; ++k) {
+                    within[k] = BOX - 1 - (order[mirror * BOX + BOX - 1 - k] - groups[mirror] * BOX);
+                }
+            } else {
+                shuffleOrder(rng, within, BOX, symmetric && mirror == g);
+            }
+            for (int k = 0; k < BOX; ++k) {
+                order[g * BOX + k] = groups[g] * BOX + within[k];
+            }
+        }
+    }
+
+    // A random permutation of 0..count-1; if symmetric, one with
+    // order[count - 1 - i] == count - 1 - order[i]
+    static void shuffleOrder(std::mt19937& rng, uint8_t* order, int count, bool symmetric) {
+        for (int i = 0; i < count; ++i) {
+            order[i] = i;
+        }
+        if (!symmetric) {
+            shuffleRange(order, order + count, rng);
+            return;
+        }
+        // Permute the mirror pairs (i, count - 1 - i) and flip each at random
+        int pairs = count / 2;
+        shuffleRange(order, order + pairs, rng);
+        for (int i = 0; i < pairs; ++i) {
+            if (randomBelow(rng, 2) != 0) order[i] = count - 1 - order[i];
+            order[count - 1 - i] = count - 1 - order[i];
+        }
+    }
+};
+
+// Puzzle generator: a random solution from the shuffled backtracker, carved
+// down by the incremental uniqueness checker. Every random draw goes through
+// randomBelow() on one mt19937, so (seed, difficulty) identifies a puzzle.
+template <int BOX>
+class BasicGenerator {
+public:
+    typedef BasicGrid<BOX> Grid;
+
+    BasicGenerator() : rng(static_cast<std::mt19937::result_type>(
+                           std::chrono::steady_clock::now().time_since_epoch().count())),
+                       backtracker(&rng), symmetry(SYMMETRY_NONE), control(nullptr), rated(false),
+                       carvesDone(0), carveBudget(1) {}
+
+    explicit BasicGenerator(uint64_t seed)
+        : backtracker(&rng), symmetry(SYMMETRY_NONE), control(nullptr), rated(false),
+          carvesDone(0), carveBudget(1) {
+        setSeed(seed);
+    }
+
+    // The backtracker points at rng, so a copy would share the original's
+    BasicGenerator(const BasicGenerator&) = delete;
+    BasicGenerator& operator=(const BasicGenerator&) = delete;
+
+    // Restart the RNG from a 64-bit seed
+    void setSeed(uint64_t seed) {
+        std::seed_seq sequence{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)};
+        rng.seed(sequence);
+    }
+
+    // Generate a complete valid Sudoku solution
+    bool generateSolution(Grid& solution) {
+        solution.clear();
+        return backtracker.solve(solution);
+    }
+
+    // Create the puzzle keyed by (seed, difficulty). The same key always
+    // yields the same puzzle, so packs can be stored as keys and regenerated.
+    bool createPuzzle(Difficulty difficulty, uint64_t seed, Grid& puzzle, Grid& solution) {
+        setSeed(seed);
+        return createPuzzle(difficulty, puzzle, solution);
+    }
+
+    // Create a uniquely solvable puzzle by removing numbers from a fresh
+    // solution. If carving ends above the difficulty's band, a new solution
+    // is carved, up to MAX_ATTEMPTS times, and the sparsest puzzle is kept.
+    // When rated, puzzles are also carved again, up to MAX_RATED_ATTEMPTS
+    // times, until the logical rating matches the difficulty, keeping the
+    // closest. Returns false if the task control stopped it.
+    bool createPuzzle(Difficulty difficulty, Grid& puzzle, Grid& solution) {
+        carvesDone = 0;
+        carveBudget = rated ? MAX_RATED_ATTEMPTS * MAX_ATTEMPTS : MAX_ATTEMPTS;
+        if (!rated) return carveToBand(difficulty, puzzle, solution);
+        
+        // Locked candidates, subsets and fish mostly show up in sparse
+        // puzzles, so everything past easy is carved as far as expert's band
+        Difficulty band = difficulty == EASY ? EASY : EXPERT;
+        int bestDistance = -1;
+        Grid candidate, candidateSolution;
+        for (int attempt = 0; attempt < MAX_RATED_ATTEMPTS && bestDistance != 0; ++attempt) {
+            if (!carveToBand(band, candidate, candidateSolution)) return false;
+            int distance = std::abs(techniqueDifficulty(rater.rate(candidate)) - difficulty);
+            if (bestDistance < 0 || distance < bestDistance) {
+                bestDistance = distance;
+                puzzle = candidate;
+                solution = candidateSolution;
+            }
+        }
+        return true;
+    }
+
+    // A copy of seedPuzzle (whose solution is seedSolution) under a random
+    // transform: it looks fresh but has the same difficulty, rating and
+    // unique solution up to relabelling, and costs microseconds instead of
+    // a generation. With a symmetry set, symmetric patterns stay symmetric.
+    void createVariant(const Grid& seedPuzzle, const Grid& seedSolution, Grid& puzzle,
+                       Grid& solution) {
+        BasicTransform<BOX> transform;
+        transform.randomize(rng, symmetry);
+        transform.apply(seedPuzzle, puzzle);
+        transform.apply(seedSolution, solution);
+    }
+
+    // The variant of seedPuzzle keyed by seed
+    void createVariant(const Grid& seedPuzzle, const Grid& seedSolution, uint64_t seed,
+                       Grid& puzzle, Grid& solution) {
+        setSeed(seed);
+        createVariant(seedPuzzle, seedSolution, puzzle, solution);
+    }
+
+    // Keep the clue pattern symmetric from now on
+    void setSymmetry(Symmetry pattern) { symmetry = pattern; }
+    Symmetry getSymmetry() const { return symmetry; }
+
+    // Accept only puzzles whose logical rating (see BasicLogicalSolver)
+    // matches the difficulty asked for, on top of its clue band
+    void setRated(bool enabled) { rated = enabled; }
+    bool isRated() const { return rated; }
+
+    // Poll taskControl while carving, and report progress to it; null for
+    // none. It must outlive any createPuzzle() call made while set.
+    void setControl(const TaskControl* taskControl) { control = taskControl; }
+
+private:
+    static const int SIZE = Dimensions<BOX>::SIZE;
+    static const int CELL_COUNT = Dimensions<BOX>::CELL_COUNT;
+
+    // createPuzzle() without the rating
+    bool carveToBand(Difficulty difficulty, Grid& puzzle, Grid& solution) {
+        // Difficulty is in 9x9 clues; the spread of 6 scales the same way
+        int spread = 6 * CELL_COUNT / 81;
+        int targetClues = difficulty * CELL_COUNT / 81 + static_cast<int>(randomBelow(rng, spread));
+        int bandTop = difficulty * CELL_COUNT / 81 + spread - 1;
+        
+        int bestClues = CELL_COUNT + 1;
+        Grid candidate;
+        for (int attempt = 0; attempt < MAX_ATTEMPTS && bestClues > bandTop; ++attempt) {
+            if (!generateSolution(candidate)) return false;
+            int clues = carve(candidate, targetClues);
+            if (clues < 0) return false;
+            ++carvesDone;
+            if (clues < bestClues) {
+                bestClues = clues;
+                puzzle = checker.puzzle();
+                solution = candidate;
+            }
+        }
+        return true;
+    }
+    
+    // Uniqueness proofs stay small up to 9x9 and are left exact, so existing
+    // seeds keep their puzzles. On bigger boards they can blow up once around
+    // half the clues are gone; a removal that cannot be settled within the
+    // budget keeps its clue, and the puzzle ends up above its target instead.
+    static const uint64_t REMOVAL_NODE_BUDGET = BOX <= 3 ? 0 : 256;
+    
+    // Fresh solutions to carve before settling above the band. Only worth
+    // it where uniqueness proofs are exact.
+    static const int MAX_ATTEMPTS = BOX <= 3 ? 4 : 1;
+    
+    // Fresh puzzles a rated createPuzzle() carves before settling
+    static const int MAX_RATED_ATTEMPTS = 64;
+    
+    // Removal groups between polls of the task control
+    static const int CONTROL_INTERVAL = 16;
+
+    // The cell a clue at cell is removed together with under the symmetry
+    int partner(int cell) const {
+        int row = cell / SIZE, col = cell % SIZE;
+        switch (symmetry) {
+            case SYMMETRY_ROTATIONAL: return (SIZE - 1 - row) * SIZE + (SIZE - 1 - col);
+            case SYMMETRY_MIRROR: return row * SIZE + (SIZE - 1 - col);
+            case SYMMETRY_NONE: break;
+        }
+        return cell;
+    }
+
+    // Remove clues from solved, one symmetric group at a time in random
+    // order, until targetClues are left or no group can go; returns the
+    // clues left, or -1 if the task control stopped it. A removal that
+    // fails once fails for good, since removing more only adds solutions,
+    // so a single pass ends at a puzzle that is minimal for its pattern.
+    // The checker keeps its masks between removals, and cells forced by a
+    // hidden single are let go without a search. Progress is reported as a
+    // share of every carve createPuzzle() may make, so it never goes back;
+    // a puzzle that settles early skips the rest.
+    int carve(const Grid& solved, int targetClues) {
+        checker.reset(solved);
+        
+        int groups[CELL_COUNT];
+        int groupCount = 0;
+        for (int i = 0; i < CELL_COUNT; ++i) {
+            if (partner(i) >= i) groups[groupCount++] = i;
+        }
+        shuffleRange(groups, groups + groupCount, rng);
+        
+        int clues = CELL_COUNT;
+        for (int g = 0; g < groupCount && clues > targetClues; ++g) {
+            if (control != nullptr && g % CONTROL_INTERVAL == 0) {
+                if (control->shouldStop()) return -1;
+                control->report((carvesDone + static_cast<double>(g) / groupCount) / carveBudget);
+            }
+            int cells[2] = {groups[g], partner(groups[g])};
+            int size = cells[0] == cells[1] ? 1 : 2;
+            if (clues - size < targetClues) continue;
+            // Only removals that keep the solution unique are kept
+            if (checker.tryRemove(cells, size, REMOVAL_NODE_BUDGET)) clues -= size;
+        }
+        return clues;
+    }
+
+    std::mt19937 rng;
+    BasicBacktracker<BOX> backtracker;
+    BasicUniquenessChecker<BOX> checker;
+    Symmetry symmetry;
+    const TaskControl* control;
+    bool rated;
+    int carvesDone;     // Carves finished by the createPuzzle() in progress
+    int carveBudget;    // Most carves it can make
+    BasicLogicalSolver<BOX> rater;
+};
+
+// Bounded stock of ready puzzles per difficulty, kept topped up by
+// background threads so a new game is a constant-time pop. A level that
+// drops below lowWater is refilled to capacity; the workers sleep while
+// every level is above its mark. Each worker has its own generator,
+// seeded from std::random_device. Destroying the pool stops the workers,
+// waiting for any puzzle they are in the middle of.
+template <int BOX>
+class BasicPuzzlePool {
+public:
+    typedef BasicGrid<BOX> Grid;
+
+    explicit BasicPuzzlePool(size_t capacity = DEFAULT_CAPACITY, size_t lowWater = DEFAULT_LOW_WATER,
+                             int threadCount = 1)
+        : limit(std::max<size_t>(capacity, 1)), mark(std::min(lowWater, limit)), stopping(false) {
+        static const Difficulty DIFFICULTIES[LEVELS] = {EASY, MEDIUM, HARD, EXPERT};
+        for (int l = 0; l < LEVELS; ++l) {
+            levels[l].difficulty = DIFFICULTIES[l];
+            levels[l].building = 0;
+            levels[l].refilling = true;
+        }
+        
+        std::random_device entropy;
+        for (int i = 0; i < std::max(threadCount, 1); ++i) {
+            uint64_t seed = (static_cast<uint64_t>(entropy()) << 32) | entropy();
+            workers.emplace_back(&BasicPuzzlePool::work, this, seed);
+        }
+    }
+
+    ~BasicPuzzlePool() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+    }
+
+    // Pop a ready puzzle of the difficulty; false if that level is empty
+    // right now, in which case the caller generates one itself
+    bool take(Difficulty difficulty, Grid& puzzle, Grid& solution) {
+        std::lock_guard<std::mutex> guard(lock);
+        Level* level = find(difficulty);
+        if (level == nullptr || level->ready.empty()) return false;
+        
+        puzzle = level->ready.front().puzzle;
+        solution = level->ready.front().solution;
+        level->ready.pop_front();
+        if (level->ready.size() < mark && !level->refilling) {
+            level->refilling = true;
+            wake.notify_all();
+        }
+        return true;
+    }
+
+    // Puzzles of the difficulty ready to take
+    size_t available(Difficulty difficulty) {
+        std::lock_guard<std::mutex> guard(lock);
+        Level* level = find(difficulty);
+        return level == nullptr ? 0 : level->ready.size();
+    }
+
+    static const size_t DEFAULT_CAPACITY = 8;
+    static const size_t DEFAULT_LOW_WATER = 4;
+
+private:
+    static const int LEVELS = 4;
+
+    struct Entry {
+        Grid puzzle;
+        Grid solution;
+    };
+
+    struct Level {
+        Difficulty difficulty;
+        std::deque<Entry> ready;
+        size_t building;    // Puzzles workers are generating for this level
+        bool refilling;     // Topping up to capacity after falling below the mark
+    };
+
+    Level* find(Difficulty difficulty) {
+        for (int l = 0; l < LEVELS; ++l) {
+            if (levels[l].difficulty == difficulty) return &levels[l];
+        }
+        return nullptr;
+    }
+
+    // The refilling level with the fewest puzzles ready or on the way, or
+    // null if none needs one
+    Level* neediest() {
+        Level* best = nullptr;
+        for (int l = 0; l < LEVELS; ++l) {
+            Level& level = levels[l];
+            size_t stock = level.ready.size() + level.building;
+            if (!level.refilling || stock >= limit) continue;
+            if (best == nullptr || stock < best->ready.size() + best->building) best = &level;
+        }
+        return best;
+    }
+
+    void work(uint64_t seed) {
+        BasicGenerator<BOX> generator(seed);
+        Entry entry;
+        std::unique_lock<std::mutex> guard(lock);
+        while (true) {
+            Level* level;
+            while (!stopping && (level = neediest()) == nullptr) wake.wait(guard);
+            if (stopping) return;
+            
+            ++level->building;
+            guard.unlock();
+            bool made = generator.createPuzzle(level->difficulty, entry.puzzle, entry.solution);
+            guard.lock();
+            --level->building;
+            
+            if (made) level->ready.push_back(entry);
+            if (level->ready.size() + level->building >= limit) level->refilling = false;
+        }
+    }
+
+    size_t limit;       // Capacity per level
+    size_t mark;        // Low-water mark per level
+    Level levels[LEVELS];
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stopping;
+    std::vector<std::thread> workers;
+};
+
+template <int BOX> const size_t BasicPuzzlePool<BOX>::DEFAULT_CAPACITY;
+template <int BOX> const size_t BasicPuzzlePool<BOX>::DEFAULT_LOW_WATER;
+
+// How a controlled solve or generation ended
+enum TaskStatus {
+    TASK_DONE,        // Solved, or a puzzle was generated
+    TASK_FAILED,      // The puzzle has no solution
+    TASK_CANCELLED,
+    TASK_TIMED_OUT
+};
+
+template <int BOX>
+struct BasicTaskResult {
+    TaskStatus status;
+    BasicGrid<BOX> puzzle;
+    BasicGrid<BOX> solution;    // Set when status is TASK_DONE
+};
+
+// Guesses a controlled solve makes between polls of its control
+const uint64_t TASK_SLICE_NODES = 1024;
+
+inline TaskStatus stoppedStatus(const TaskControl& control) {
+    return control.cancelled() ? TASK_CANCELLED : TASK_TIMED_OUT;
+}
+
+// Solve puzzle on the calling thread in slices of TASK_SLICE_NODES
+// guesses, stopping between slices if control says so. It reaches the
+// same solution as Backtracker.
+template <int BOX>
+BasicTaskResult<BOX> solveTask(const BasicGrid<BOX>& puzzle, const TaskControl& control) {
+    typedef BasicSearchState<BOX> SearchState;
+    BasicTaskResult<BOX> result;
+    result.puzzle = puzzle;
+    
+    SearchState search;
+    typename SearchState::Status status = search.start(puzzle);
+    while (status == SearchState::RUNNING) {
+        if (control.shouldStop()) {
+            result.status = stoppedStatus(control);
+            return result;
+        }
+        control.report(search.explored());
+        status = search.run(TASK_SLICE_NODES);
+    }
+    
+    if (status == SearchState::SOLVED) {
+        result.status = TASK_DONE;
+        result.solution = search.solution();
+        control.report(1.0);
+    } else {
+        result.status = TASK_FAILED;
+    }
+    return result;
+}
+
+// Create the puzzle keyed by (seed, difficulty) on the calling thread,
+// stopping between removals if control says so
+template <int BOX>
+BasicTaskResult<BOX> generateTask(Difficulty difficulty, uint64_t seed, const TaskControl& control,
+                                  Symmetry symmetry = SYMMETRY_NONE) {
+    BasicGenerator<BOX> generator;
+    generator.setSymmetry(symmetry);
+    generator.setControl(&control);
+    
+    BasicTaskResult<BOX> result;
+    if (generator.createPuzzle(difficulty, seed, result.puzzle, result.solution)) {
+        result.status = TASK_DONE;
+        control.report(1.0);
+    } else {
+        // Generation from an empty grid only fails when stopped
+        result.status = stoppedStatus(control);
+    }
+    return result;
+}
+
+// solveTask() and generateTask() on a thread of their own. Keep a copy of
+// control to cancel the work; an abandoned future should be cancelled,
+// since the future's destructor waits for the work to finish.
+template <int BOX>
+std::future<BasicTaskResult<BOX> > solveAsync(const BasicGrid<BOX>& puzzle,
+                                              const TaskControl& control = TaskControl()) {
+    return std::async(std::launch::async, [puzzle, control]() { return solveTask(puzzle, control); });
+}
+
+template <int BOX = 3>  // 9x9 unless given
+std::future<BasicTaskResult<BOX> > generateAsync(Difficulty difficulty, uint64_t seed,
+                                                 const TaskControl& control = TaskControl(),
+                                                 Symmetry symmetry = SYMMETRY_NONE) {
+    return std::async(std::launch::async, [difficulty, seed, control, symmetry]() {
+        return generateTask<BOX>(difficulty, seed, control, symmetry);
+    });
+}
+
+// Binary corpus of puzzle/solution pairs. A HEADER_SIZE header is followed
+// by fixed-size records, record i at HEADER_SIZE + i * RECORD_SIZE, so a
+// corpus is read in place, typically from an mmap of the file. A record is
+// the givens as a bitmap, one bit per cell, then the solution with
+// DIGIT_BITS per cell holding digit - 1, both least significant bit first.
+// The header, all integers little-endian:
+//
+//   0   "SDKC"         magic
+//   4   u16 version    CORPUS_VERSION
+//   6   u8  box        BOX
+//   7   u8  sections   CORPUS_SECTIONS
+//   8   u32 record size
+//   12  u32 record count
+//   16  CORPUS_SECTIONS x {u32 difficulty, u32 first record, u32 count}
+//
+// The sections index the records by difficulty; each difficulty's records
+// are contiguous, and unused sections have a count of 0.
+const int CORPUS_VERSION = 1;
+const int CORPUS_SECTIONS = 4;
+
+struct CorpusSection {
+    uint32_t difficulty;    // A Difficulty value
+    uint32_t first;
+    uint32_t count;
+};
+
+template <int BOX>
+struct BasicCorpusFormat {
+    typedef Dimensions<BOX> Dim;
+    typedef BasicGrid<BOX> Grid;
+
+    static const int HEADER_SIZE = 16 + CORPUS_SECTIONS * 12;
+    static const int DIGIT_BITS = Dim::SIZE <= 4 ? 2 : Dim::SIZE <= 16 ? 4 : 5;
+    static const int GIVEN_BYTES = (Dim::CELL_COUNT + 7) / 8;
+    static const int RECORD_SIZE = GIVEN_BYTES + (Dim::CELL_COUNT * DIGIT_BITS + 7) / 8;
+
+    static void writeHeader(uint8_t* out, uint32_t recordCount, const CorpusSection* sections) {
+        std::fill(out, out + HEADER_SIZE, 0);
+        out[0] = 'S';
+        out[1] = 'D';
+        out[2] = 'K';
+        out[3] = 'C';
+        store(out + 4, CORPUS_VERSION, 2);
+        out[6] = BOX;
+        out[7] = CORPUS_SECTIONS;
+        store(out + 8, RECORD_SIZE, 4);
+        store(out + 12, recordCount, 4);
+        for (int s = 0; s < CORPUS_SECTIONS; ++s) {
+            store(out + 16 + 12 * s, sections[s].difficulty, 4);
+            store(out + 20 + 12 * s, sections[s].first, 4);
+            store(out + 24 + 12 * s, sections[s].count, 4);
+        }
+    }
+
+    // Pack a puzzle and its full solution into RECORD_SIZE bytes
+    static void encode(const Grid& puzzle, const Grid& solution, uint8_t* record) {
+        std::fill(record, record + RECORD_SIZE, 0);
+        uint8_t* digits = record + GIVEN_BYTES;
+        for (int i = 0; i < Dim::CELL_COUNT; ++i) {
+            if (puzzle.cells[i] != EMPTY) record[i / 8] |= 1 << (i % 8);
+            int bit = i * DIGIT_BITS;
+            uint32_t value = static_cast<uint32_t>(solution.cells[i] - 1) << (bit % 8);
+            digits[bit / 8] |= value & 0xFF;
+            if (bit % 8 + DIGIT_BITS > 8) digits[bit / 8 + 1] |= value >> 8;
+        }
+    }
+
+    // Unpack a record; returns false if it holds digits out of range
+    static bool decode(const uint8_t* record, Grid& puzzle, Grid& solution) {
+        const uint8_t* digits = record + GIVEN_BYTES;
+        for (int i = 0; i < Dim::CELL_COUNT; ++i) {
+            int bit = i * DIGIT_BITS;
+            uint32_t value = digits[bit / 8];
+            if (bit % 8 + DIGIT_BITS > 8) value |= static_cast<uint32_t>(digits[bit / 8 + 1]) << 8;
+            int num = static_cast<int>((value >> (bit % 8)) & ((1u << DIGIT_BITS) - 1)) + 1;
+            if (num > Dim::SIZE) return false;
+            solution.cells[i] = num;
+            puzzle.cells[i] = (record[i / 8] >> (i % 8)) & 1 ? num : EMPTY;
+        }
+        return true;
+    }
+
+    static uint32_t load(const uint8_t* in, int bytes) {
+        uint32_t value = 0;
+        for (int i = bytes - 1; i >= 0; --i) value = (value << 8) | in[i];
+        return value;
+    }
+
+    static void store(uint8_t* out, uint32_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i) out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+};
+
+template <int BOX> const int BasicCorpusFormat<BOX>::HEADER_SIZE;
+template <int BOX> const int BasicCorpusFormat<BOX>::DIGIT_BITS;
+template <int BOX> const int BasicCorpusFormat<BOX>::GIVEN_BYTES;
+template <int BOX> const int BasicCorpusFormat<BOX>::RECORD_SIZE;
+
+// Read-only view of a corpus image in memory; it never copies the image,
+// which must outlive the view
+template <int BOX>
+class BasicCorpusView {
+public:
+    typedef BasicCorpusFormat<BOX> Format;
+    typedef BasicGrid<BOX> Grid;
+
+    BasicCorpusView() : data(nullptr), count(0) {
+        std::fill(sections, sections + CORPUS_SECTIONS, CorpusSection());
+    }
+
+    // Attach to bytes; returns false, leaving the view empty, unless they
+    // are a well-formed corpus for this board size
+    bool attach(const uint8_t* bytes, size_t length) {
+        data = nullptr;
+        count = 0;
+        if (!isCorpus(bytes, length) || bytes[6] != BOX || bytes[7] != CORPUS_SECTIONS ||
+            Format::load(bytes + 4, 2) != CORPUS_VERSION ||
+            Format::load(bytes + 8, 4) != static_cast<uint32_t>(Format::RECORD_SIZE)) {
+            return false;
+        }
+        
+        uint32_t records = Format::load(bytes + 12, 4);
+        if ((length - Format::HEADER_SIZE) / Format::RECORD_SIZE < records) return false;
+        for (int s = 0; s < CORPUS_SECTIONS; ++s) {
+            sections[s].difficulty = Format::load(bytes + 16 + 12 * s, 4);
+            sections[s].first = Format::load(bytes + 20 + 12 * s, 4);
+            sections[s].count = Format::load(bytes + 24 + 12 * s, 4);
+            if (sections[s].first > records || sections[s].count > records - sections[s].first) {
+                return false;
+            }
+        }
+        data = bytes;
+        count = records;
+        return true;
+    }
+
+    // Whether bytes start like a corpus of any board size and version
+    static bool isCorpus(const uint8_t* bytes, size_t length) {
+        return length >= static_cast<size_t>(Format::HEADER_SIZE) && bytes[0] == 'S' &&
+               bytes[1] == 'D' && bytes[2] == 'K' && bytes[3] == 'C';
+    }
+
+    size_t size() const { return count; }
+
+    // The records of one difficulty, as [first, first + count); false if it has none
+    bool section(Difficulty difficulty, size_t& first, size_t& sectionCount) const {
+        for (int s = 0; s < CORPUS_SECTIONS; ++s) {
+            if (sections[s].difficulty == static_cast<uint32_t>(difficulty) && sections[s].count > 0) {
+                first = sections[s].first;
+                sectionCount = sections[s].count;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Unpack record i (< size()); false if the record is corrupt
+    bool read(size_t i, Grid& puzzle, Grid& solution) const {
+        return Format::decode(data + Format::HEADER_SIZE + i * Format::RECORD_SIZE, puzzle, solution);
+    }
+
+private:
+    const uint8_t* data;
+    size_t count;
+    CorpusSection sections[CORPUS_SECTIONS];
+};
+
+// Canonical form of a grid: of all its BasicTransform images, the one that
+// is smallest read in row-major order, with empty cells sorting after every
+// digit. Two puzzles share a canonical form exactly when one is a transform
+// of the other. Each (transposition, first row, column order) is scored on
+// the first row, and the ties are then extended a row at a time, keeping
+// only those tied for the smallest prefix. Digits are relabelled in order
+// of first appearance, which is the smallest labelling of any one image.
+// There are (BOX!)^(BOX + 1) column orders, so this is only practical for
+// 4x4 and 9x9 boards: about 40 us for a 9x9 puzzle, 2 ms for a full grid.
+template <int BOX>
+class BasicCanonicalizer {
+public:
+    typedef Dimensions<BOX> Dim;
+    typedef BasicGrid<BOX> Grid;
+    typedef BasicTransform<BOX> Transform;
+
+    // Set canonical to the canonical form of grid and transform to a
+    // transform taking grid to it
+    void canonicalize(const Grid& grid, Grid& canonical, Transform& transform) {
+        const std::vector<Order>& orders = columnOrders();
+        for (int r = 0; r < Dim::SIZE; ++r) {
+            for (int c = 0; c < Dim::SIZE; ++c) {
+                views[0](r, c) = grid(r, c);
+                views[1](r, c) = grid(c, r);
+            }
+        }
+        
+        current.clear();
+        std::fill(best, best + Dim::SIZE, UNSET);
+        Candidate start;
+        std::fill(start.labels, start.labels + Dim::SIZE + 1, EMPTY);
+        start.nextLabel = 1;
+        // Only rows whose clues can be packed furthest left can start the
+        // canonical form, so the column orders are tried for those alone
+        uint32_t shapes[2][Dim::SIZE];
+        uint32_t bestShape = ~0u;
+        for (int t = 0; t < 2; ++t) {
+            for (int r = 0; r < Dim::SIZE; ++r) {
+                shapes[t][r] = packedShape(views[t], r);
+                bestShape = std::min(bestShape, shapes[t][r]);
+            }
+        }
+        for (int t = 0; t < 2; ++t) {
+            start.transpose = t;
+            for (int r = 0; r < Dim::SIZE; ++r) {
+                if (shapes[t][r] != bestShape) continue;
+                start.rows[0] = r;
+                for (size_t o = 0; o < orders.size(); ++o) {
+                    start.order = static_cast<uint32_t>(o);
+                    offer(start, 0, current);
+                }
+            }
+        }
+        
+        for (int level = 1; level < Dim::SIZE; ++level) {
+            next.clear();
+            std::fill(best, best + Dim::SIZE, UNSET);
+            for (size_t i = 0; i < current.size(); ++i) {
+                Candidate candidate = current[i];
+                int used = 0;
+                for (int k = 0; k < level; ++k) {
+                    used |= 1 << candidate.rows[k];
+                }
+                // A new band may start with any row of an unused band; a
+                // band in progress continues with one of its own rows
+                int first = 0, last = Dim::SIZE;
+                if (level % BOX != 0) {
+                    first = candidate.rows[level - 1] / BOX * BOX;
+                    last = first + BOX;
+                }
+                for (int r = first; r < last; ++r) {
+                    if (used & (1 << r)) continue;
+                    if (level % BOX == 0 && (used >> (r / BOX * BOX)) & 1) continue;
+                    candidate.rows[level] = r;
+                    offer(candidate, level, next);
+                }
+            }
+            current.swap(next);
+        }
+        
+        const Candidate& chosen = current.front();
+        transform.transpose = chosen.transpose != 0;
+        std::copy(chosen.rows, chosen.rows + Dim::SIZE, transform.rows);
+        std::copy(orders[chosen.order].begin(), orders[chosen.order].end(), transform.cols);
+        // Digits missing from the grid take the remaining labels in order
+        int label = chosen.nextLabel;
+        transform.digits[EMPTY] = EMPTY;
+        for (int n = 1; n <= Dim::SIZE; ++n) {
+            transform.digits[n] = chosen.labels[n] != EMPTY ? chosen.labels[n] : label++;
+        }
+        transform.apply(grid, canonical);
+    }
+
+private:
+    typedef std::array<uint8_t, Dim::SIZE> Order;
+
+    static const uint8_t UNSET = 0xFF;          // Sorts after any row
+    static const uint8_t BLANK = Dim::SIZE + 1; // Empty cell, after every label
+
+    struct Candidate {
+        uint8_t transpose;
+        uint32_t order;     // Index into columnOrders()
+        uint8_t rows[Dim::SIZE];
+        uint8_t labels[Dim::SIZE + 1];  // Source digit to label, EMPTY if not seen yet
+        uint8_t nextLabel;
+    };
+
+    // Every column order that keeps stacks together, built on first use
+    static const std::vector<Order>& columnOrders() {
+        static const std::vector<Order> orders = buildOrders();
+        return orders;
+    }
+
+    static std::vector<Order> buildOrders() {
+        std::array<uint8_t, BOX> within, stacks;
+        for (int i = 0; i < BOX; ++i) {
+            within[i] = stacks[i] = i;
+        }
+        std::vector<std::array<uint8_t, BOX> > perms;
+        do {
+            perms.push_back(within);
+        } while (std::next_permutation(within.begin(), within.end()));
+        
+        std::vector<Order> orders;
+        do {
+            // One permutation per stack, counted as the digits of picks
+            size_t combinations = 1;
+            for (int s = 0; s < BOX; ++s) {
+                combinations *= perms.size();
+            }
+            for (size_t picks = 0; picks < combinations; ++picks) {
+                Order order;
+                size_t rest = picks;
+                for (int s = 0; s < BOX; ++s) {
+                    const std::array<uint8_t, BOX>& perm = perms[rest % perms.size()];
+                    rest /= perms.size();
+                    for (int k = 0; k < BOX; ++k) {
+                        order[s * BOX + k] = stacks[s] * BOX + perm[k];
+                    }
+                }
+                orders.push_back(order);
+            }
+        } while (std::next_permutation(stacks.begin(), stacks.end()));
+        return orders;
+    }
+
+    // The empty cells of row once its columns are ordered to put clues as
+    // far left as possible, one bit per cell from the left, set if empty
+    static uint32_t packedShape(const Grid& view, int row) {
+        int clues[BOX];
+        for (int s = 0; s < BOX; ++s) {
+            clues[s] = 0;
+            for (int k = 0; k < BOX; ++k) {
+                if (view(row, s * BOX + k) != EMPTY) ++clues[s];
+            }
+        }
+        std::sort(clues, clues + BOX, std::greater<int>());
+        uint32_t shape = 0;
+        for (int s = 0; s < BOX; ++s) {
+            for (int k = 0; k < BOX; ++k) {
+                shape = (shape << 1) | (k < clues[s] ? 0 : 1);
+            }
+        }
+        return shape;
+    }
+
+    // Score row level of candidate, labelling digits as they appear, against
+    // the best row so far. Keep it in into if it is no worse, dropping
+    // everything already in into if it is strictly better.
+    void offer(Candidate candidate, int level, std::vector<Candidate>& into) {
+        const Order& order = columnOrders()[candidate.order];
+        const Grid& view = views[candidate.transpose];
+        int row = candidate.rows[level];
+        uint8_t keys[Dim::SIZE];
+        bool better = false;
+        for (int c = 0; c < Dim::SIZE; ++c) {
+            int num = view(row, order[c]);
+            if (num == EMPTY) {
+                keys[c] = BLANK;
+            } else {
+                if (candidate.labels[num] == EMPTY) candidate.labels[num] = candidate.nextLabel++;
+                keys[c] = candidate.labels[num];
+            }
+            if (!better) {
+                if (keys[c] > best[c]) return;
+                better = keys[c] < best[c];
+            }
+        }
+        if (better) {
+            into.clear();
+            std::copy(keys, keys + Dim::SIZE, best);
+        }
+        into.push_back(candidate);
+    }
+
+    Grid views[2];  // The grid and its transpose
+    uint8_t best[Dim::SIZE];
+    std::vector<Candidate> current, next;
+};
+
+template <int BOX> const uint8_t BasicCanonicalizer<BOX>::UNSET;
+template <int BOX> const uint8_t BasicCanonicalizer<BOX>::BLANK;
+
+// FNV-1a over the cells, for hashing grids in unordered containers
+template <int BOX>
+struct BasicGridHash {
+    size_t operator()(const BasicGrid<BOX>& grid) const {
+        uint64_t hash = 14695981039346656037ULL;
+        for (int i = 0; i < Dimensions<BOX>::CELL_COUNT; ++i) {
+            hash = (hash ^ grid.cells[i]) * 1099511628211ULL;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+// Solutions keyed by canonical form, so a puzzle that is a transform of
+// one solved before is answered by mapping the stored solution back. Once
+// capacity entries are stored, new solutions are no longer remembered.
+template <int BOX>
+class BasicSolutionCache {
+public:
+    typedef BasicGrid<BOX> Grid;
+
+    explicit BasicSolutionCache(size_t capacity = DEFAULT_CAPACITY)
+        : limit(capacity), hitCount(0), missCount(0) {}
+
+    // If a transform of puzzle has been stored, set solution to puzzle's
+    // solution and return true. Either way puzzle becomes the puzzle that
+    // store() records a solution for.
+    bool lookup(const Grid& puzzle, Grid& solution) {
+        canonicalizer.canonicalize(puzzle, pending, transform);
+        typename Map::const_iterator it = entries.find(pending);
+        if (it == entries.end()) {
+            ++missCount;
+            return false;
+        }
+        ++hitCount;
+        transform.revert(it->second, solution);
+        return true;
+    }
+
+    // Remember solution as the solution of the last puzzle looked up
+    void store(const Grid& solution) {
+        if (entries.size() >= limit) return;
+        Grid image;
+        transform.apply(solution, image);
+        entries.emplace(pending, image);
+    }
+
+    size_t size() const { return entries.size(); }
+    uint64_t hits() const { return hitCount; }
+    uint64_t misses() const { return missCount; }
+
+    static const size_t DEFAULT_CAPACITY = 1 << 20;
+
+private:
+    typedef std::unordered_map<Grid, Grid, BasicGridHash<BOX> > Map;
+
+    size_t limit;
+    uint64_t hitCount;
+    uint64_t missCount;
+    BasicCanonicalizer<BOX> canonicalizer;
+    BasicTransform<BOX> transform;  // Takes the pending puzzle to its canonical form
+    Grid pending;
+    Map entries;
+};
+
+template <int BOX> const size_t BasicSolutionCache<BOX>::DEFAULT_CAPACITY;
+
+// The standard 9x9 board
+
+const int BOX_SIZE = 3;
+const int SIZE = Dimensions<BOX_SIZE>::SIZE;
+const int CELL_COUNT = Dimensions<BOX_SIZE>::CELL_COUNT;
+const int UNIT_COUNT = Dimensions<BOX_SIZE>::UNIT_COUNT;
+
+typedef Dimensions<BOX_SIZE>::Mask DigitMask;
+const DigitMask ALL_DIGITS = Dimensions<BOX_SIZE>::ALL_DIGITS;
+
+typedef BasicGrid<BOX_SIZE> Grid;
+typedef BasicCandidateMasks<BOX_SIZE> CandidateMasks;
+typedef BasicUnitTable<BOX_SIZE> UnitTable;
+typedef BasicPlacementTrail<BOX_SIZE> PlacementTrail;
+typedef BasicUniquenessChecker<BOX_SIZE> UniquenessChecker;
+typedef BasicDlxSolver<BOX_SIZE> DlxSolver;
+typedef BasicParallelSolver<BOX_SIZE> ParallelSolver;
+typedef BasicBacktracker<BOX_SIZE> Backtracker;
+typedef BasicSolver<BOX_SIZE> Solver;
+typedef BasicGenerator<BOX_SIZE> Generator;
+typedef BasicLogicalSolver<BOX_SIZE> LogicalSolver;
+typedef BasicPuzzlePool<BOX_SIZE> PuzzlePool;
+typedef BasicTaskResult<BOX_SIZE> TaskResult;
+typedef BasicCorpusFormat<BOX_SIZE> CorpusFormat;
+typedef BasicCorpusView<BOX_SIZE> CorpusView;
+typedef BasicTransform<BOX_SIZE> Transform;
+typedef BasicCanonicalizer<BOX_SIZE> Canonicalizer;
+typedef BasicGridHash<BOX_SIZE> GridHash;
+typedef BasicSolutionCache<BOX_SIZE> SolutionCache;
+
+// One bit per cell, indexed by cellIndex()
+typedef std::bitset<CELL_COUNT> CellSet;
+
+static_assert(sizeof(Grid) <= 128, "Grid should fit in two cache lines");
+
+inline int cellIndex(int row, int col) {
+    return Grid::index(row, col);
+}
+
+inline const UnitTable& unitTable() {
+    return UnitTable::instance();
+}
+
+} // namespace sudoku
+
+#endif // SUDOKU_H